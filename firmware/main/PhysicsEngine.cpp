@@ -1,4 +1,5 @@
 #include "physics_engine.h"
+#include "perf_timer.h"
 #include <string.h>
 #include <stdlib.h>
 
@@ -8,6 +9,11 @@
 
 PhysicsConfig CONFIG;
 
+// Shared scratch for theta-window copies fed to median/percentile.  The
+// physics path is single-threaded, so one module-level buffer is safe and
+// keeps HISTORY_MAX-sized arrays off the loop task's stack.
+static float s_thetaScratch[HISTORY_MAX];
+
 // =============================================================================
 // UTILITY FUNCTIONS
 // =============================================================================
@@ -22,31 +28,57 @@ float physics_lerp(float a, float b, float t) {
     return a + (b - a) * t;
 }
 
-static int _cmp_float(const void* a, const void* b) {
-    float fa = *(float*)a, fb = *(float*)b;
-    return (fa > fb) - (fa < fb);
+// Iterative quickselect (Hoare partition): after the call arr[k] holds the
+// k-th smallest value, everything left of k is <= it, everything right >= it.
+// O(n) expected, no comparator function-pointer overhead, reorders in place.
+static void physics_select(float* arr, int len, int k) {
+    int lo = 0, hi = len - 1;
+    while (lo < hi) {
+        float pivot = arr[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (arr[i] < pivot) i++;
+            while (arr[j] > pivot) j--;
+            if (i <= j) {
+                float t = arr[i]; arr[i] = arr[j]; arr[j] = t;
+                i++; j--;
+            }
+        }
+        if      (k <= j) hi = j;
+        else if (k >= i) lo = i;
+        else break;
+    }
 }
 
+// NOTE: median/percentile reorder `arr` in place.  Callers pass copies made
+// into the shared scratch arena (s_thetaScratch), so nothing HISTORY_MAX-
+// sized ever lands on the loop task's stack and nothing gets fully sorted.
 float physics_median(float* arr, int len) {
     if (len <= 0) return 0.0f;
-    float tmp[len];
-    memcpy(tmp, arr, len * sizeof(float));
-    qsort(tmp, len, sizeof(float), _cmp_float);
     int mid = len / 2;
-    return (len % 2 == 0) ? (tmp[mid - 1] + tmp[mid]) * 0.5f : tmp[mid];
+    physics_select(arr, len, mid);
+    if (len % 2 != 0) return arr[mid];
+    // Even length: partner value is the max of the lower partition
+    float lower = arr[0];
+    for (int i = 1; i < mid; i++)
+        if (arr[i] > lower) lower = arr[i];
+    return (lower + arr[mid]) * 0.5f;
 }
 
 float physics_percentile(float* arr, int len, float p) {
     if (len <= 0) return 0.0f;
-    float tmp[len];
-    memcpy(tmp, arr, len * sizeof(float));
-    qsort(tmp, len, sizeof(float), _cmp_float);
     float index = (p / 100.0f) * (len - 1);
     int   lower = (int)index;
     int   upper = lower + 1;
-    if (upper >= len) return tmp[len - 1];
+    physics_select(arr, len, lower);
+    if (upper >= len) return arr[len - 1];
     float weight = index - lower;
-    return tmp[lower] * (1.0f - weight) + tmp[upper] * weight;
+    if (weight <= 0.0f) return arr[lower];
+    // Interpolation partner is the min of the upper partition
+    float upperVal = arr[upper];
+    for (int i = upper + 1; i < len; i++)
+        if (arr[i] < upperVal) upperVal = arr[i];
+    return arr[lower] * (1.0f - weight) + upperVal * weight;
 }
 
 float physics_std(float* arr, int len) {
@@ -107,7 +139,9 @@ float SensorCalibration::calibrate(int raw, float temp_c) {
 }
 
 QCResult SensorCalibration::qualityControl(float theta, float temp_c,
-                                            DataPoint* history, int historyLen) {
+                                            const HistoryBuffer& history,
+                                            const HistoryStats& stats) {
+    int historyLen = history.len();
     QCResult result;
     result.valid = true;
     result.flags[0] = '\0';
@@ -122,31 +156,19 @@ QCResult SensorCalibration::qualityControl(float theta, float temp_c,
     if (theta < CONFIG.theta_bounds_min || theta > CONFIG.theta_bounds_max)
         addFlag("OUT_OF_BOUNDS");
 
-    // Spike detection (z-score)
+    // Spike detection (z-score against the rolling 5-point window —
+    // maintained incrementally, nothing recomputed here)
     if (historyLen >= 3) {
-        int  n      = min(historyLen, 5);
-        float recent[5];
-        for (int i = 0; i < n; i++)
-            recent[i] = history[historyLen - n + i].theta;
-        float sum = 0;
-        for (int i = 0; i < n; i++) sum += recent[i];
-        float mean = sum / n;
-        float sd   = physics_std(recent, n);
+        float mean = stats.spikeWindow.mean();
+        float sd   = stats.spikeWindow.stddev();
         float z    = fabsf((theta - mean) / (sd + 0.001f));
         if (z > CONFIG.spike_z_thresh) addFlag("SPIKE_DETECTED");
     }
 
-    // Stuck sensor check
+    // Stuck sensor check (range of the rolling 10-point window)
     if (historyLen >= 10) {
-        float recent[10];
-        for (int i = 0; i < 10; i++)
-            recent[i] = history[historyLen - 10 + i].theta;
-        float mn = recent[0], mx = recent[0];
-        for (int i = 1; i < 10; i++) {
-            if (recent[i] < mn) mn = recent[i];
-            if (recent[i] > mx) mx = recent[i];
-        }
-        if ((mx - mn) < CONFIG.stuck_eps) addFlag("SENSOR_STUCK");
+        if (stats.stuckWindow.range() < CONFIG.stuck_eps)
+            addFlag("SENSOR_STUCK");
     }
 
     // Temperature sanity
@@ -159,19 +181,90 @@ QCResult SensorCalibration::qualityControl(float theta, float temp_c,
 // SOIL MODEL
 // =============================================================================
 
+// Lookup-table grids.  psi covers 0.1 cm .. 10^6 cm in log10 space; Se
+// covers [SE_GRID_MIN, SE_GRID_MAX] uniformly (the exact kernels clamp to
+// the same interior range, so the tables never sample the singularities).
+static const float VG_LOG_PSI_MIN = -1.0f;
+static const float VG_LOG_PSI_MAX =  6.0f;
+static const float VG_SE_GRID_MIN =  0.005f;
+static const float VG_SE_GRID_MAX =  0.999f;
+
 SoilModel::SoilModel() {
     params.m = 1.0f - (1.0f / params.n);
+    rebuildLookupTables();
     params.theta_fc  = vanGenuchten_theta(330.0f);    // -33 kPa
     params.theta_pwp = vanGenuchten_theta(15000.0f);  // -1500 kPa
 }
 
 SoilModel::SoilModel(SoilParams p) : params(p) {
     params.m = 1.0f - (1.0f / params.n);
+    rebuildLookupTables();
     if (params.theta_fc  <= 0.0f) params.theta_fc  = vanGenuchten_theta(330.0f);
     if (params.theta_pwp <= 0.0f) params.theta_pwp = vanGenuchten_theta(15000.0f);
 }
 
+void SoilModel::rebuildLookupTables() {
+    const float theta_r = params.theta_r;
+    const float theta_s = params.theta_s;
+
+    for (int i = 0; i < VG_LUT_SIZE; i++) {
+        float t = (float)i / (VG_LUT_SIZE - 1);
+
+        // theta over log-spaced psi
+        float logPsi = VG_LOG_PSI_MIN + t * (VG_LOG_PSI_MAX - VG_LOG_PSI_MIN);
+        lutTheta[i] = vanGenuchten_theta_exact(powf(10.0f, logPsi));
+
+        // ln(psi) and ln(K) over uniform Se
+        float Se    = VG_SE_GRID_MIN + t * (VG_SE_GRID_MAX - VG_SE_GRID_MIN);
+        float theta = theta_r + Se * (theta_s - theta_r);
+        lutLogPsi[i] = logf(vanGenuchten_psi_exact(theta));
+        lutLogK[i]   = logf(hydraulicConductivity_exact(theta));
+    }
+}
+
+// Shared interpolation helper: table lookup over a uniform grid in x.
+static float _lut_interp(const float* table, int size,
+                          float x, float xMin, float xMax) {
+    float pos = (x - xMin) / (xMax - xMin) * (size - 1);
+    if (pos <= 0.0f) return table[0];
+    if (pos >= (float)(size - 1)) return table[size - 1];
+    int   idx = (int)pos;
+    float w   = pos - idx;
+    return table[idx] * (1.0f - w) + table[idx + 1] * w;
+}
+
 float SoilModel::vanGenuchten_theta(float psi_cm) {
+    if (!CONFIG.use_vg_lut) return vanGenuchten_theta_exact(psi_cm);
+    if (psi_cm <= 0.0f) return params.theta_s;
+
+    float logPsi = log10f(psi_cm);
+    if (logPsi <= VG_LOG_PSI_MIN) return lutTheta[0];
+    if (logPsi >= VG_LOG_PSI_MAX) return lutTheta[VG_LUT_SIZE - 1];
+    return _lut_interp(lutTheta, VG_LUT_SIZE,
+                       logPsi, VG_LOG_PSI_MIN, VG_LOG_PSI_MAX);
+}
+
+float SoilModel::vanGenuchten_psi(float theta) {
+    if (!CONFIG.use_vg_lut) return vanGenuchten_psi_exact(theta);
+
+    float Se = effectiveSaturation(theta);
+    float logPsi = _lut_interp(lutLogPsi, VG_LUT_SIZE,
+                               Se, VG_SE_GRID_MIN, VG_SE_GRID_MAX);
+    return expf(logPsi);
+}
+
+float SoilModel::hydraulicConductivity(float theta) {
+    if (!CONFIG.use_vg_lut) return hydraulicConductivity_exact(theta);
+
+    float Se = effectiveSaturation(theta);
+    if (Se >= 1.0f) return params.Ks;
+    if (Se <= 0.01f) return params.Ks * 1e-10f;
+    float logK = _lut_interp(lutLogK, VG_LUT_SIZE,
+                             Se, VG_SE_GRID_MIN, VG_SE_GRID_MAX);
+    return expf(logK);
+}
+
+float SoilModel::vanGenuchten_theta_exact(float psi_cm) {
     const float theta_r = params.theta_r;
     const float theta_s = params.theta_s;
     const float alpha   = params.alpha;
@@ -184,7 +277,7 @@ float SoilModel::vanGenuchten_theta(float psi_cm) {
     return theta_r + (theta_s - theta_r) / powf(term, m);
 }
 
-float SoilModel::vanGenuchten_psi(float theta) {
+float SoilModel::vanGenuchten_psi_exact(float theta) {
     const float theta_r = params.theta_r;
     const float theta_s = params.theta_s;
     const float alpha   = params.alpha;
@@ -204,7 +297,7 @@ float SoilModel::effectiveSaturation(float theta) {
         0.0f, 1.0f);
 }
 
-float SoilModel::hydraulicConductivity(float theta) {
+float SoilModel::hydraulicConductivity_exact(float theta) {
     float Se = effectiveSaturation(theta);
     float m  = params.m;
     const float L = 0.5f;
@@ -234,24 +327,21 @@ AvailableWater SoilModel::availableWater(float theta, float rootDepth_cm) {
 
 EventDetection::EventDetection() {}
 
-bool EventDetection::detectWetting(DataPoint* history, int len,
+bool EventDetection::detectWetting(const HistoryBuffer& history,
                                     float* delta_theta_out) {
     *delta_theta_out = 0.0f;
+    int len = history.len();
     if (len < 2) return false;
 
-    time_t now         = history[len - 1].timestamp;
+    time_t now         = history.timestamp(len - 1);
     time_t windowStart = now - CONFIG.wet_window;
 
-    // Find window start index
-    int startIdx = 0;
-    for (int i = len - 1; i >= 0; i--) {
-        if (history[i].timestamp < windowStart) { startIdx = i + 1; break; }
-    }
+    int startIdx = history.firstIndexAtOrAfter(windowStart);
 
     if ((len - startIdx) < 2) return false;
 
-    float thetaStart = history[startIdx].theta;
-    float thetaEnd   = history[len - 1].theta;
+    float thetaStart = history.theta(startIdx);
+    float thetaEnd   = history.theta(len - 1);
     float delta      = thetaEnd - thetaStart;
     *delta_theta_out = delta;
 
@@ -265,29 +355,27 @@ bool EventDetection::detectWetting(DataPoint* history, int len,
     return false;
 }
 
-float EventDetection::calculateDryingRate(DataPoint* history, int len,
+float EventDetection::calculateDryingRate(const HistoryBuffer& history,
                                            uint32_t windowSeconds) {
+    int len = history.len();
     if (len < 3) return 0.0f;
     if (windowSeconds == 0) windowSeconds = CONFIG.slope_window;
 
-    time_t now         = history[len - 1].timestamp;
+    time_t now         = history.timestamp(len - 1);
     time_t windowStart = now - windowSeconds;
 
-    int startIdx = 0;
-    for (int i = len - 1; i >= 0; i--) {
-        if (history[i].timestamp < windowStart) { startIdx = i + 1; break; }
-    }
+    int startIdx = history.firstIndexAtOrAfter(windowStart);
 
     int n = len - startIdx;
     if (n < 3) return 0.0f;
 
     // Linear regression
-    time_t t0   = history[startIdx].timestamp;
+    time_t t0   = history.timestamp(startIdx);
     float sumX  = 0, sumY = 0, sumXY = 0, sumX2 = 0;
 
     for (int i = startIdx; i < len; i++) {
-        float x = (history[i].timestamp - t0) / 3600.0f;  // hours
-        float y = history[i].theta;
+        float x = (history.timestamp(i) - t0) / 3600.0f;  // hours
+        float y = history.theta(i);
         sumX  += x;
         sumY  += y;
         sumXY += x * y;
@@ -300,41 +388,38 @@ float EventDetection::calculateDryingRate(DataPoint* history, int len,
     return (n * sumXY - sumX * sumY) / denom;  // m³/m³/hr
 }
 
-bool EventDetection::detectFCPlateau(DataPoint* history, int len,
+bool EventDetection::detectFCPlateau(const HistoryBuffer& history,
                                       float* theta_fc_candidate_out) {
     *theta_fc_candidate_out = 0.0f;
+    int len = history.len();
     if (len < 20) return false;
 
-    float rate = calculateDryingRate(history, len);
+    float rate = calculateDryingRate(history);
 
     if (fabsf(rate) >= CONFIG.s_min) return false;
 
     // Check sustained for hold_hours
-    uint32_t holdSeconds = CONFIG.hold_hours * 3600;
-    time_t   now         = history[len - 1].timestamp;
+    uint32_t holdSeconds  = CONFIG.hold_hours * 3600;
+    time_t   now          = history.timestamp(len - 1);
     time_t   plateauStart = now - holdSeconds;
 
-    int plateauCount = 0;
-    float thetaVals[HISTORY_MAX];
-
-    for (int i = 0; i < len; i++) {
-        if (history[i].timestamp >= plateauStart) {
-            thetaVals[plateauCount++] = history[i].theta;
-        }
-    }
+    int startIdx     = history.firstIndexAtOrAfter(plateauStart);
+    int plateauCount = len - startIdx;
 
     if (plateauCount < 10) return false;
 
-    *theta_fc_candidate_out = physics_median(thetaVals, plateauCount);
+    history.copyTheta(startIdx, plateauCount, s_thetaScratch);
+    *theta_fc_candidate_out = physics_median(s_thetaScratch, plateauCount);
     return true;
 }
 
-void EventDetection::classifyRegime(DataPoint* history, int len,
+void EventDetection::classifyRegime(const HistoryBuffer& history,
                                      float theta_fc, char* regimeOut) {
+    int len = history.len();
     if (len < 5) { strcpy(regimeOut, "unknown"); return; }
 
-    float rate         = calculateDryingRate(history, len);
-    float currentTheta = history[len - 1].theta;
+    float rate         = calculateDryingRate(history);
+    float currentTheta = history.theta(len - 1);
 
     if (rate > 0.001f)              { strcpy(regimeOut, "wetting");  return; }
     if (fabsf(rate) < CONFIG.s_min) { strcpy(regimeOut, "stable");   return; }
@@ -368,34 +453,38 @@ float DynamicsModel::drydownRate(float theta) {
     return -params.ku * powf(theta - params.theta_min, params.beta);
 }
 
-bool DynamicsModel::fitDrainageParameter(DataPoint* data, int len,
-                                          float theta_fc, float* kd_out) {
-    if (len < 5) return false;
-
-    time_t t0     = data[0].timestamp;
-    float  theta0 = data[0].theta;
-
-    float sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0;
-    int   n    = 0;
-
-    for (int i = 0; i < len; i++) {
-        if (data[i].theta <= theta_fc) continue;
-        float delta = data[i].theta - theta_fc;
-        if (delta < 0.001f) continue;
+void DynamicsModel::accumulateDrainage(time_t ts, float theta,
+                                       float theta_fc) {
+    float delta = theta - theta_fc;
+    if (delta < 0.001f) return;   // at/below FC — not a drainage point
+
+    if (drain.n == 0) drain.t0 = ts;
+    float x = (ts - drain.t0) / 3600.0f;
+    float y = logf(delta);
+    drain.sumX  += x;      drain.sumY  += y;
+    drain.sumXY += x * y;  drain.sumX2 += x * x;
+    drain.n++;
+}
 
-        float x = (data[i].timestamp - t0) / 3600.0f;
-        float y = logf(delta);
-        sumX  += x;  sumY  += y;
-        sumXY += x * y;  sumX2 += x * x;
-        n++;
+void DynamicsModel::accumulateDrydown(time_t ts, float theta) {
+    if (dry.n == 0) {
+        dry.tStart   = ts;
+        dry.theta0   = theta;
+        dry.thetaMin = theta;
     }
+    if (theta < dry.thetaMin) dry.thetaMin = theta;
+    dry.thetaLast = theta;
+    dry.tLast     = ts;
+    dry.n++;
+}
 
-    if (n < 5) return false;
+bool DynamicsModel::fitDrainageFromStats(float* kd_out) const {
+    if (drain.n < 5) return false;
 
-    float denom = n * sumX2 - sumX * sumX;
+    float denom = drain.n * drain.sumX2 - drain.sumX * drain.sumX;
     if (fabsf(denom) < 1e-9f) return false;
 
-    float slope = (n * sumXY - sumX * sumY) / denom;
+    float slope = (drain.n * drain.sumXY - drain.sumX * drain.sumY) / denom;
     float kd    = -slope;
 
     if (kd < 0.001f || kd > 1.0f) return false;
@@ -404,24 +493,19 @@ bool DynamicsModel::fitDrainageParameter(DataPoint* data, int len,
     return true;
 }
 
-bool DynamicsModel::fitDrydownParameters(DataPoint* data, int len,
-                                          float* ku_out, float* beta_out,
-                                          float* theta_min_out) {
-    if (len < 10) return false;
+bool DynamicsModel::fitDrydownFromStats(float* ku_out, float* beta_out,
+                                        float* theta_min_out) const {
+    if (dry.n < 10) return false;
 
-    float theta_min = data[0].theta;
-    for (int i = 1; i < len; i++)
-        if (data[i].theta < theta_min) theta_min = data[i].theta;
-    theta_min -= 0.01f;
+    float theta_min = dry.thetaMin - 0.01f;
+    float t_end     = (dry.tLast - dry.tStart) / 3600.0f;
 
-    float theta0  = data[0].theta;
-    float theta_e = data[len - 1].theta;
-    float t_end   = (data[len - 1].timestamp - data[0].timestamp) / 3600.0f;
-
-    if (theta_e <= theta_min || theta0 <= theta_min || t_end <= 0.0f)
+    if (dry.thetaLast <= theta_min || dry.theta0 <= theta_min ||
+        t_end <= 0.0f)
         return false;
 
-    float ku = -logf((theta_e - theta_min) / (theta0 - theta_min)) / t_end;
+    float ku = -logf((dry.thetaLast - theta_min) /
+                     (dry.theta0 - theta_min)) / t_end;
 
     if (ku <= 0.0f || ku >= 0.1f) return false;
 
@@ -442,35 +526,49 @@ AutoCalibration::AutoCalibration(SoilModel*      sm,
     memset(fc_history, 0, sizeof(fc_history));
 }
 
-void AutoCalibration::update(DataPoint& point, DataPoint* history, int historyLen) {
+void AutoCalibration::update(DataPoint& point, const HistoryBuffer& history,
+                             const HistoryStats& hstats) {
     stats.qc_total_count++;
     if (point.qc_valid) stats.qc_pass_count++;
 
+    // Feed the per-segment sufficient statistics before the state step:
+    // drainage points while tracking post-event decay, drydown points
+    // afterwards.  Wetting transitions below reset both segments.
+    if (point.qc_valid) {
+        if (state == CAL_DRAINAGE_TRACKING || state == CAL_FC_ESTIMATE)
+            dynamicsModel->accumulateDrainage(point.timestamp, point.theta,
+                                              theta_fc_star);
+        else if (state == CAL_DRYDOWN_FIT || state == CAL_NORMAL_OPERATION)
+            dynamicsModel->accumulateDrydown(point.timestamp, point.theta);
+    }
+
+    CalibrationState prev = state;
     switch (state) {
-        case CAL_INIT:               state_init(history, historyLen);             break;
-        case CAL_BASELINE_MONITORING: state_baseline(point, history, historyLen); break;
-        case CAL_WETTING_EVENT:       state_wetting(point);                       break;
-        case CAL_DRAINAGE_TRACKING:   state_drainage(point, history, historyLen); break;
-        case CAL_FC_ESTIMATE:         state_fc_estimate(history, historyLen);     break;
-        case CAL_DRYDOWN_FIT:         state_drydown_fit(history, historyLen);     break;
-        case CAL_NORMAL_OPERATION:    state_normal(point, history, historyLen);   break;
+        case CAL_INIT:                state_init(history, hstats);     break;
+        case CAL_BASELINE_MONITORING: state_baseline(point, history);  break;
+        case CAL_WETTING_EVENT:       state_wetting(point);            break;
+        case CAL_DRAINAGE_TRACKING:   state_drainage(point, history);       break;
+        case CAL_FC_ESTIMATE:         state_fc_estimate(history, hstats);   break;
+        case CAL_DRYDOWN_FIT:         state_drydown_fit(history);           break;
+        case CAL_NORMAL_OPERATION:    state_normal(point, history);         break;
     }
+    if (state != prev)
+        dirty = true;   // caller persists a snapshot on transitions
 
     updateConfidence();
 }
 
-void AutoCalibration::state_init(DataPoint* history, int len) {
+void AutoCalibration::state_init(const HistoryBuffer& history,
+                                 const HistoryStats& hstats) {
+    int len = history.len();
     if (len < 10) return;   // Need at least 10 samples before starting
 
     // Seed FC from van Genuchten model
     if (theta_fc_star < 0.0f)
         theta_fc_star = soilModel->params.theta_fc;
 
-    // Estimate theta_dry from history percentile
-    float thetaVals[HISTORY_MAX];
-    for (int i = 0; i < len; i++) thetaVals[i] = history[i].theta;
-    float theta_dry = physics_percentile(thetaVals, len,
-                                         CONFIG.theta_dry_percentile * 100.0f);
+    // theta_dry from the streaming P² estimate — no copy, no sort
+    float theta_dry = hstats.thetaDry.value();
 
     theta_refill_star = theta_fc_star -
         CONFIG.eta_refill * (theta_fc_star - theta_dry);
@@ -479,35 +577,42 @@ void AutoCalibration::state_init(DataPoint* history, int len) {
     state = CAL_BASELINE_MONITORING;
 }
 
-void AutoCalibration::state_baseline(DataPoint& point, DataPoint* history, int len) {
+void AutoCalibration::state_baseline(DataPoint& point, const HistoryBuffer& history) {
     float delta = 0.0f;
-    if (eventDetection->detectWetting(history, len, &delta)) {
+    if (eventDetection->detectWetting(history, &delta)) {
         stats.n_events++;
         state              = CAL_WETTING_EVENT;
         currentEventStart  = point.timestamp;
+        dynamicsModel->resetSegments();   // new event, new segments
     }
 }
 
 void AutoCalibration::state_wetting(DataPoint& point) {
-    if ((point.timestamp - currentEventStart) > (time_t)CONFIG.post_event_ignore)
+    if ((point.timestamp - currentEventStart) > (time_t)CONFIG.post_event_ignore) {
         state = CAL_DRAINAGE_TRACKING;
+        // Drainage statistics start after the post-event ignore window,
+        // matching the points the full-history fit used to select.
+        dynamicsModel->drain.reset();
+    }
 }
 
-void AutoCalibration::state_drainage(DataPoint& point, DataPoint* history, int len) {
+void AutoCalibration::state_drainage(DataPoint& /*point*/,
+                                     const HistoryBuffer& history) {
     float candidate = 0.0f;
-    if (eventDetection->detectFCPlateau(history, len, &candidate)) {
+    if (eventDetection->detectFCPlateau(history, &candidate)) {
         state        = CAL_FC_ESTIMATE;
         fc_candidate = candidate;
         return;
     }
 
     char regime[16];
-    eventDetection->classifyRegime(history, len, theta_fc_star, regime);
+    eventDetection->classifyRegime(history, theta_fc_star, regime);
     if (strcmp(regime, "drydown") == 0)
         state = CAL_NORMAL_OPERATION;
 }
 
-void AutoCalibration::state_fc_estimate(DataPoint* history, int len) {
+void AutoCalibration::state_fc_estimate(const HistoryBuffer& history,
+                                        const HistoryStats& hstats) {
     // EWMA update of FC
     if (theta_fc_star < 0.0f) {
         theta_fc_star = fc_candidate;
@@ -520,23 +625,24 @@ void AutoCalibration::state_fc_estimate(DataPoint* history, int len) {
         fc_history[fc_history_len++] = theta_fc_star;
 
     stats.n_fc_updates++;
-    updateRefillThreshold(history, len);
+    updateRefillThreshold(history, hstats);
 
-    // Try to fit kd from drainage data
+    // Refit kd from the drainage-segment sufficient statistics
     float kd = 0.0f;
-    if (dynamicsModel->fitDrainageParameter(history, len, theta_fc_star, &kd))
+    if (dynamicsModel->fitDrainageFromStats(&kd))
         dynamicsModel->params.kd = kd;
 
     state = CAL_DRYDOWN_FIT;
+    dynamicsModel->dry.reset();   // drydown segment starts here
 }
 
-void AutoCalibration::state_drydown_fit(DataPoint* history, int len) {
+void AutoCalibration::state_drydown_fit(const HistoryBuffer& history) {
     char regime[16];
-    eventDetection->classifyRegime(history, len, theta_fc_star, regime);
+    eventDetection->classifyRegime(history, theta_fc_star, regime);
 
-    if (strcmp(regime, "drydown") == 0 && len >= 10) {
+    if (strcmp(regime, "drydown") == 0) {
         float ku = 0, beta = 0, theta_min = 0;
-        if (dynamicsModel->fitDrydownParameters(history, len, &ku, &beta, &theta_min)) {
+        if (dynamicsModel->fitDrydownFromStats(&ku, &beta, &theta_min)) {
             dynamicsModel->params.ku        = ku;
             dynamicsModel->params.beta      = beta;
             dynamicsModel->params.theta_min = theta_min;
@@ -546,22 +652,34 @@ void AutoCalibration::state_drydown_fit(DataPoint* history, int len) {
     state = CAL_NORMAL_OPERATION;
 }
 
-void AutoCalibration::state_normal(DataPoint& point, DataPoint* history, int len) {
+void AutoCalibration::state_normal(DataPoint& point, const HistoryBuffer& history) {
     float delta = 0.0f;
-    if (eventDetection->detectWetting(history, len, &delta)) {
+    if (eventDetection->detectWetting(history, &delta)) {
         stats.n_events++;
         state             = CAL_WETTING_EVENT;
         currentEventStart = point.timestamp;
+        dynamicsModel->resetSegments();
+        return;
+    }
+
+    // Refit on every sample: the segment statistics make this a handful
+    // of flops, so the drydown parameters keep converging between events
+    // instead of freezing at the last CAL_DRYDOWN_FIT snapshot.
+    float ku = 0, beta = 0, theta_min = 0;
+    if (dynamicsModel->fitDrydownFromStats(&ku, &beta, &theta_min)) {
+        dynamicsModel->params.ku        = ku;
+        dynamicsModel->params.beta      = beta;
+        dynamicsModel->params.theta_min = theta_min;
     }
 }
 
-void AutoCalibration::updateRefillThreshold(DataPoint* history, int len) {
-    if (len < 10) return;
+void AutoCalibration::updateRefillThreshold(const HistoryBuffer& history,
+                                            const HistoryStats& hstats) {
+    if (history.len() < 10) return;
 
-    float thetaVals[HISTORY_MAX];
-    for (int i = 0; i < len; i++) thetaVals[i] = history[i].theta;
-    float theta_dry = physics_percentile(thetaVals, len,
-                                         CONFIG.theta_dry_percentile * 100.0f);
+    // Streaming P² estimate of the theta_dry percentile — replaces the
+    // qsort over the full 30-day window on every invocation
+    float theta_dry = hstats.thetaDry.value();
 
     theta_refill_star = theta_fc_star -
         CONFIG.eta_refill * (theta_fc_star - theta_dry);
@@ -624,6 +742,49 @@ void AutoCalibration::restoreCalibrationState(const CalibrationResult& r) {
     stats.n_fc_updates = r.n_fc_updates;
 }
 
+void AutoCalibration::getSnapshot(CalibrationSnapshot& out) {
+    memset(&out, 0, sizeof(out));
+    out.magic   = CAL_SNAPSHOT_MAGIC;
+    out.version = CAL_SNAPSHOT_VERSION;
+    out.state             = (int32_t)state;
+    out.theta_fc_star     = theta_fc_star;
+    out.theta_refill_star = theta_refill_star;
+    out.confidence        = confidence;
+    out.n_events          = stats.n_events;
+    out.n_fc_updates      = stats.n_fc_updates;
+    out.qc_pass_rate      = (stats.qc_total_count > 0)
+        ? (float)stats.qc_pass_count / stats.qc_total_count
+        : 0.0f;
+    out.kd        = dynamicsModel->params.kd;
+    out.ku        = dynamicsModel->params.ku;
+    out.beta      = dynamicsModel->params.beta;
+    out.theta_min = dynamicsModel->params.theta_min;
+    memcpy(out.fc_history, fc_history, sizeof(fc_history));
+    out.fc_history_len = fc_history_len;
+    out.fc_candidate   = fc_candidate;
+}
+
+void AutoCalibration::restoreSnapshot(const CalibrationSnapshot& s) {
+    if (s.magic != CAL_SNAPSHOT_MAGIC || s.version != CAL_SNAPSHOT_VERSION)
+        return;
+    if (s.theta_fc_star > 0)     theta_fc_star     = s.theta_fc_star;
+    if (s.theta_refill_star > 0) theta_refill_star = s.theta_refill_star;
+    state       = (CalibrationState)s.state;
+    confidence  = s.confidence;
+    stats.n_events     = s.n_events;
+    stats.n_fc_updates = s.n_fc_updates;
+    dynamicsModel->params.kd        = s.kd;
+    dynamicsModel->params.ku        = s.ku;
+    dynamicsModel->params.beta      = s.beta;
+    dynamicsModel->params.theta_min = s.theta_min;
+    memcpy(fc_history, s.fc_history, sizeof(fc_history));
+    fc_history_len = (s.fc_history_len > FC_HISTORY_MAX)
+        ? FC_HISTORY_MAX : s.fc_history_len;
+    if (fc_history_len < 0) fc_history_len = 0;
+    fc_candidate = s.fc_candidate;
+    dirty = false;   // just restored — nothing new to persist
+}
+
 const char* AutoCalibration::stateToString(CalibrationState s) {
     switch (s) {
         case CAL_INIT:                 return "INIT";
@@ -645,12 +806,8 @@ PhysicsEngine Physics;   // Global singleton
 
 PhysicsEngine::PhysicsEngine()
     : autoCalibration(&soilModel, &eventDetection, &dynamicsModel) {
-    _historyLen = 0;
-    memset(&extConfig, 0, sizeof(extConfig));
-    extConfig.p            = -1.0f;
-    extConfig.theta_fc     = -1.0f;
-    extConfig.theta_wp     = -1.0f;
-    extConfig.theta_refill = -1.0f;
+    _stats.reset(CONFIG.theta_dry_percentile);
+    extConfig = ExternalConfig();   // member initializers carry the -1s
 }
 
 void PhysicsEngine::configureCropSoil(const char* crop, const char* soil,
@@ -681,29 +838,49 @@ void PhysicsEngine::configureCropSoil(const char* crop, const char* soil,
             extConfig.theta_fc - extConfig.p * (extConfig.theta_fc - extConfig.theta_wp);
     }
 
+    // Soil parameters may have changed — refresh the retention-curve tables
+    soilModel.rebuildLookupTables();
+
     Serial.printf("[Physics] Configured: crop=%s soil=%s fc=%.3f refill=%.3f\n",
                   crop, soil, autoCalibration.theta_fc_star,
                   autoCalibration.theta_refill_star);
 }
 
 void PhysicsEngine::pushHistory(DataPoint& p) {
-    if (_historyLen < HISTORY_MAX) {
-        _history[_historyLen++] = p;
-    } else {
-        // Shift left (drop oldest)
-        memmove(_history, _history + 1, (HISTORY_MAX - 1) * sizeof(DataPoint));
-        _history[HISTORY_MAX - 1] = p;
-    }
+    _history.push(p);
+    _stats.addTheta(p.theta);
+}
+
+bool PhysicsEngine::rehydrateHistoryPoint(const DataPoint& p) {
+    return _history.pushOlder(p);
+}
+
+void PhysicsEngine::finishRehydration() {
+    // The streaming stats are order-sensitive, so replay the restored
+    // history oldest-first instead of feeding them during the reversed
+    // prepend pass.
+    _stats.reset(CONFIG.theta_dry_percentile);
+    for (int i = 0; i < _history.len(); i++)
+        _stats.addTheta(_history.theta(i));
 }
 
 SensorReading PhysicsEngine::processSensorReading(int raw, float temp_c,
                                                    time_t timestamp) {
+    PERF_SCOPE("physics.total");
+
     // Step 1: Calibrate
-    float theta = calibration.calibrate(raw, temp_c);
+    float theta;
+    {
+        PERF_SCOPE("physics.calibrate");
+        theta = calibration.calibrate(raw, temp_c);
+    }
 
     // Step 2: QC
-    QCResult qc = calibration.qualityControl(theta, temp_c,
-                                              _history, _historyLen);
+    QCResult qc;
+    {
+        PERF_SCOPE("physics.qc");
+        qc = calibration.qualityControl(theta, temp_c, _history, _stats);
+    }
 
     // Step 3: Build data point
     DataPoint point;
@@ -717,8 +894,10 @@ SensorReading PhysicsEngine::processSensorReading(int raw, float temp_c,
     pushHistory(point);
 
     // Step 5: Update auto-calibration
-    if (qc.valid)
-        autoCalibration.update(point, _history, _historyLen);
+    if (qc.valid) {
+        PERF_SCOPE("physics.autocal");
+        autoCalibration.update(point, _history, _stats);
+    }
 
     // Step 6: Build output
     SensorReading out;
@@ -728,7 +907,48 @@ SensorReading PhysicsEngine::processSensorReading(int raw, float temp_c,
     out.theta     = theta;
     out.qc_valid  = qc.valid;
 
-    calculateMetrics(point, out);
+    {
+        PERF_SCOPE("physics.metrics");
+        calculateMetrics(point, out);
+    }
+    return out;
+}
+
+SensorReading PhysicsEngine::processSensorBatch(BatchPoint* rows, int n) {
+    PERF_SCOPE("physics.batch");
+
+    // Dense pass: calibrate + QC + history + autocal per row.  The
+    // streaming stats make each step O(1); what the batch saves is the
+    // metrics stage (drying-rate regression, van Genuchten, available
+    // water), which only the newest point needs.
+    DataPoint point = {};
+    for (int i = 0; i < n; i++) {
+        float theta = calibration.calibrate(rows[i].raw, rows[i].temp_c);
+        QCResult qc =
+            calibration.qualityControl(theta, rows[i].temp_c, _history, _stats);
+        rows[i].theta    = theta;
+        rows[i].qc_valid = qc.valid;
+
+        point.timestamp = rows[i].timestamp;
+        point.raw       = rows[i].raw;
+        point.temp_c    = rows[i].temp_c;
+        point.theta     = theta;
+        point.qc_valid  = qc.valid;
+        pushHistory(point);
+
+        if (qc.valid)
+            autoCalibration.update(point, _history, _stats);
+    }
+
+    SensorReading out = {};
+    if (n > 0) {
+        out.timestamp = point.timestamp;
+        out.raw_adc   = point.raw;
+        out.temp_c    = point.temp_c;
+        out.theta     = point.theta;
+        out.qc_valid  = point.qc_valid;
+        calculateMetrics(point, out);
+    }
     return out;
 }
 
@@ -758,19 +978,18 @@ void PhysicsEngine::calculateMetrics(DataPoint& point, SensorReading& out) {
     out.fractionDepleted = aw.fractionDepleted;
 
     // Drying rate
-    out.dryingRate_per_hr = eventDetection.calculateDryingRate(
-        _history, _historyLen);
+    out.dryingRate_per_hr = eventDetection.calculateDryingRate(_history);
 
     // Regime
-    eventDetection.classifyRegime(_history, _historyLen,
-                                  theta_fc, out.regime);
+    eventDetection.classifyRegime(_history, theta_fc, out.regime);
 
     // Irrigation status
     IrrigationStatus status = getIrrigationStatus(
         point.theta, theta_fc, theta_refill, out.dryingRate_per_hr);
-    strncpy(out.status,         status.state,          15);
-    strncpy(out.recommendation, status.recommendation, 63);
-    strncpy(out.urgency,        status.urgency,         7);
+    snprintf(out.status, sizeof(out.status), "%s", status.state);
+    snprintf(out.recommendation, sizeof(out.recommendation), "%s",
+             status.recommendation);
+    snprintf(out.urgency, sizeof(out.urgency), "%s", status.urgency);
 
     // Calibration
     out.confidence = cal.confidence;
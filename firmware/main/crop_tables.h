@@ -0,0 +1,304 @@
+#ifndef CROP_TABLES_H
+#define CROP_TABLES_H
+
+// Generated by tools/gen_crop_tables.py from config/crop_thresholds.json
+// (version "1.0") — do not edit by hand; rerun the generator.
+//
+// Compile-time crop/soil parameter tables.  Stage rows are
+// flattened crop-major so a crop is a [first, first+count)
+// slice of CROP_STAGES.  Keys match the JSON keys exactly;
+// the JSON on SD is now only an override layer.
+
+#include <stdint.h>
+#include <string.h>
+
+struct CropStageRow {
+    const char* name;
+    int16_t     day_start;
+    int16_t     day_end;
+    float       Zr_cm;
+    float       p;
+};
+
+struct CropRow {
+    const char* key;
+    int16_t     total_days;
+    int16_t     stage_first;
+    int16_t     stage_count;
+};
+
+struct SoilRow {
+    const char* key;
+    float       theta_fc;
+    float       theta_wp;
+};
+
+constexpr SoilRow SOIL_TABLE[] = {
+    { "sandy_loam", 0.2f, 0.08f },
+    { "loam", 0.31f, 0.14f },
+    { "clay_loam", 0.36f, 0.2f },
+    { "clay", 0.42f, 0.24f },
+};
+constexpr int SOIL_TABLE_LEN = 4;
+
+constexpr CropStageRow CROP_STAGES[] = {
+    { "early", 0, 70, 100.0f, 0.55f },
+    { "late", 71, 150, 170.0f, 0.55f },
+    { "early", 0, 50, 80.0f, 0.5f },
+    { "late", 51, 100, 120.0f, 0.5f },
+    { "early", 0, 50, 100.0f, 0.55f },
+    { "late", 51, 150, 150.0f, 0.65f },
+    { "early", 0, 180, 100.0f, 0.55f },
+    { "late", 181, 250, 150.0f, 0.65f },
+    { "early", 0, 45, 100.0f, 0.55f },
+    { "late", 46, 135, 150.0f, 0.65f },
+    { "early", 0, 45, 100.0f, 0.55f },
+    { "late", 46, 135, 150.0f, 0.65f },
+    { "early", 0, 60, 50.0f, 0.2f },
+    { "late", 61, 150, 100.0f, 0.2f },
+    { "early", 0, 50, 100.0f, 0.55f },
+    { "late", 51, 115, 200.0f, 0.55f },
+    { "early", 0, 55, 100.0f, 0.55f },
+    { "late", 56, 125, 200.0f, 0.55f },
+    { "early", 0, 55, 100.0f, 0.55f },
+    { "late", 56, 125, 200.0f, 0.55f },
+    { "early", 0, 55, 40.0f, 0.4f },
+    { "late", 56, 130, 60.0f, 0.45f },
+    { "early", 0, 50, 100.0f, 0.65f },
+    { "late", 51, 150, 150.0f, 0.65f },
+    { "early", 0, 40, 50.0f, 0.5f },
+    { "late", 41, 70, 100.0f, 0.5f },
+    { "early", 0, 60, 50.0f, 0.4f },
+    { "late", 61, 210, 100.0f, 0.45f },
+    { "early", 0, 190, 70.0f, 0.4f },
+    { "late", 191, 360, 100.0f, 0.45f },
+    { "early", 0, 60, 70.0f, 0.55f },
+    { "late", 61, 160, 120.0f, 0.55f },
+    { "early", 0, 50, 50.0f, 0.4f },
+    { "late", 51, 110, 100.0f, 0.45f },
+    { "early", 0, 50, 30.0f, 0.3f },
+    { "late", 51, 75, 50.0f, 0.3f },
+    { "early", 0, 100, 50.0f, 0.45f },
+    { "late", 101, 165, 80.0f, 0.45f },
+    { "early", 0, 80, 40.0f, 0.45f },
+    { "late", 81, 135, 60.0f, 0.45f },
+    { "early", 0, 85, 40.0f, 0.45f },
+    { "late", 86, 140, 70.0f, 0.45f },
+    { "early", 0, 65, 30.0f, 0.2f },
+    { "late", 66, 180, 50.0f, 0.2f },
+    { "early", 0, 55, 30.0f, 0.3f },
+    { "late", 56, 175, 50.0f, 0.3f },
+    { "early", 0, 40, 30.0f, 0.35f },
+    { "late", 41, 150, 60.0f, 0.4f },
+    { "early", 0, 55, 30.0f, 0.3f },
+    { "late", 56, 110, 60.0f, 0.3f },
+    { "early", 0, 65, 30.0f, 0.35f },
+    { "late", 66, 275, 60.0f, 0.4f },
+    { "early", 0, 40, 30.0f, 0.2f },
+    { "late", 41, 70, 50.0f, 0.2f },
+    { "early", 0, 15, 30.0f, 0.3f },
+    { "late", 16, 35, 50.0f, 0.3f },
+    { "early", 0, 70, 70.0f, 0.4f },
+    { "late", 71, 145, 150.0f, 0.5f },
+    { "early", 0, 70, 70.0f, 0.45f },
+    { "late", 71, 130, 120.0f, 0.45f },
+    { "early", 0, 60, 50.0f, 0.3f },
+    { "late", 61, 120, 100.0f, 0.4f },
+    { "early", 0, 50, 70.0f, 0.5f },
+    { "late", 51, 105, 120.0f, 0.5f },
+    { "early", 0, 50, 70.0f, 0.5f },
+    { "late", 51, 105, 120.0f, 0.5f },
+    { "early", 0, 75, 90.0f, 0.45f },
+    { "late", 76, 120, 150.0f, 0.5f },
+    { "early", 0, 50, 80.0f, 0.45f },
+    { "late", 51, 110, 150.0f, 0.5f },
+    { "early", 0, 50, 100.0f, 0.4f },
+    { "late", 51, 100, 150.0f, 0.5f },
+    { "early", 0, 60, 60.0f, 0.5f },
+    { "late", 61, 100, 120.0f, 0.5f },
+    { "early", 0, 60, 90.0f, 0.45f },
+    { "late", 61, 120, 150.0f, 0.5f },
+    { "early", 0, 50, 50.0f, 0.45f },
+    { "late", 51, 90, 70.0f, 0.45f },
+    { "early", 0, 50, 50.0f, 0.45f },
+    { "late", 51, 110, 70.0f, 0.45f },
+    { "early", 0, 50, 60.0f, 0.5f },
+    { "late", 51, 150, 110.0f, 0.5f },
+    { "early", 0, 40, 50.0f, 0.45f },
+    { "late", 41, 90, 90.0f, 0.45f },
+    { "early", 0, 50, 50.0f, 0.45f },
+    { "late", 51, 135, 90.0f, 0.45f },
+    { "early", 0, 50, 60.0f, 0.45f },
+    { "late", 51, 100, 130.0f, 0.45f },
+    { "early", 0, 60, 50.0f, 0.55f },
+    { "late", 61, 120, 100.0f, 0.6f },
+    { "early", 0, 50, 60.0f, 0.5f },
+    { "late", 51, 150, 110.0f, 0.5f },
+    { "early", 0, 40, 60.0f, 0.4f },
+    { "late", 41, 90, 100.0f, 0.45f },
+    { "early", 0, 50, 60.0f, 0.4f },
+    { "late", 51, 100, 100.0f, 0.45f },
+    { "early", 0, 50, 60.0f, 0.5f },
+    { "late", 51, 140, 130.0f, 0.5f },
+    { "early", 0, 80, 100.0f, 0.65f },
+    { "late", 81, 195, 170.0f, 0.7f },
+    { "early", 0, 60, 100.0f, 0.5f },
+    { "late", 61, 150, 120.0f, 0.5f },
+    { "early", 0, 65, 100.0f, 0.5f },
+    { "late", 66, 180, 150.0f, 0.5f },
+    { "early", 0, 50, 100.0f, 0.6f },
+    { "late", 51, 120, 150.0f, 0.6f },
+    { "early", 0, 55, 100.0f, 0.6f },
+    { "late", 56, 125, 200.0f, 0.6f },
+    { "early", 0, 50, 100.0f, 0.6f },
+    { "late", 51, 110, 150.0f, 0.6f },
+    { "early", 0, 60, 80.0f, 0.45f },
+    { "late", 61, 130, 150.0f, 0.45f },
+    { "early", 0, 30, 100.0f, 0.55f },
+    { "late", 31, 60, 200.0f, 0.6f },
+    { "early", 0, 15, 100.0f, 0.55f },
+    { "late", 16, 30, 200.0f, 0.6f },
+    { "early", 0, 25, 100.0f, 0.55f },
+    { "late", 26, 135, 150.0f, 0.55f },
+    { "early", 0, 30, 60.0f, 0.5f },
+    { "late", 31, 100, 120.0f, 0.5f },
+    { "early", 0, 30, 50.0f, 0.6f },
+    { "late", 31, 100, 150.0f, 0.6f },
+    { "early", 0, 30, 50.0f, 0.6f },
+    { "late", 31, 100, 150.0f, 0.6f },
+    { "active", 0, 365, 75.0f, 0.4f },
+    { "active", 0, 365, 75.0f, 0.5f },
+    { "early", 0, 95, 120.0f, 0.65f },
+    { "late", 96, 405, 200.0f, 0.7f },
+    { "early", 0, 210, 50.0f, 0.35f },
+    { "late", 211, 390, 90.0f, 0.35f },
+    { "early", 0, 180, 50.0f, 0.35f },
+    { "late", 181, 365, 90.0f, 0.35f },
+    { "early", 0, 180, 30.0f, 0.5f },
+    { "late", 181, 790, 60.0f, 0.5f },
+    { "active", 0, 365, 120.0f, 0.4f },
+    { "early", 0, 150, 120.0f, 0.5f },
+    { "late", 151, 365, 150.0f, 0.5f },
+    { "early", 0, 150, 80.0f, 0.5f },
+    { "late", 151, 365, 130.0f, 0.5f },
+    { "early", 0, 90, 100.0f, 0.5f },
+    { "late", 91, 210, 200.0f, 0.5f },
+    { "early", 0, 90, 100.0f, 0.5f },
+    { "late", 91, 210, 200.0f, 0.5f },
+    { "early", 0, 90, 100.0f, 0.5f },
+    { "late", 91, 210, 200.0f, 0.5f },
+    { "early", 0, 120, 120.0f, 0.65f },
+    { "late", 121, 270, 170.0f, 0.65f },
+    { "early", 0, 30, 170.0f, 0.5f },
+    { "late", 31, 190, 240.0f, 0.5f },
+};
+
+constexpr CropRow CROP_TABLE[] = {
+    { "maize_grain", 150, 0, 2 },
+    { "maize_sweet", 100, 2, 2 },
+    { "wheat_spring", 150, 4, 2 },
+    { "wheat_winter", 250, 6, 2 },
+    { "barley", 135, 8, 2 },
+    { "oats", 135, 10, 2 },
+    { "rice", 150, 12, 2 },
+    { "millet", 115, 14, 2 },
+    { "sorghum_grain", 125, 16, 2 },
+    { "sorghum_sweet", 125, 18, 2 },
+    { "potato", 130, 20, 2 },
+    { "sweet_potato", 150, 22, 2 },
+    { "beets_table", 70, 24, 2 },
+    { "cassava_yr1", 210, 26, 2 },
+    { "cassava_yr2", 360, 28, 2 },
+    { "sugarbeet", 160, 30, 2 },
+    { "carrot", 110, 32, 2 },
+    { "lettuce", 75, 34, 2 },
+    { "cabbage", 165, 36, 2 },
+    { "broccoli", 135, 38, 2 },
+    { "cauliflower", 140, 40, 2 },
+    { "celery", 180, 42, 2 },
+    { "garlic", 175, 44, 2 },
+    { "onion_dry", 150, 46, 2 },
+    { "onion_green", 110, 48, 2 },
+    { "onion_seed", 275, 50, 2 },
+    { "spinach", 70, 52, 2 },
+    { "radish", 35, 54, 2 },
+    { "tomato", 145, 56, 2 },
+    { "eggplant", 130, 58, 2 },
+    { "pepper_sweet", 120, 60, 2 },
+    { "cucumber_fresh", 105, 62, 2 },
+    { "cucumber_machine", 105, 64, 2 },
+    { "cantaloupe", 120, 66, 2 },
+    { "watermelon", 110, 68, 2 },
+    { "pumpkin", 100, 70, 2 },
+    { "squash_zucchini", 100, 72, 2 },
+    { "melon_sweet", 120, 74, 2 },
+    { "beans_green", 90, 76, 2 },
+    { "beans_dry", 110, 78, 2 },
+    { "chickpea", 150, 80, 2 },
+    { "fababean_fresh", 90, 82, 2 },
+    { "fababean_dry", 135, 84, 2 },
+    { "cowpea", 100, 86, 2 },
+    { "groundnut", 120, 88, 2 },
+    { "lentil", 150, 90, 2 },
+    { "pea_fresh", 90, 92, 2 },
+    { "pea_dry", 100, 94, 2 },
+    { "soybean", 140, 96, 2 },
+    { "cotton", 195, 98, 2 },
+    { "flax", 150, 100, 2 },
+    { "castor", 180, 102, 2 },
+    { "rapeseed", 120, 104, 2 },
+    { "safflower", 125, 106, 2 },
+    { "sesame", 110, 108, 2 },
+    { "sunflower", 130, 110, 2 },
+    { "alfalfa_hay", 60, 112, 2 },
+    { "alfalfa_cutting", 30, 114, 2 },
+    { "bermuda_hay", 135, 116, 2 },
+    { "clover_hay", 100, 118, 2 },
+    { "pasture_rotated", 100, 120, 2 },
+    { "pasture_extensive", 100, 122, 2 },
+    { "turf_cool", 365, 124, 1 },
+    { "turf_warm", 365, 125, 1 },
+    { "sugarcane", 405, 126, 2 },
+    { "banana_yr1", 390, 128, 2 },
+    { "banana_yr2", 365, 130, 2 },
+    { "pineapple", 790, 132, 2 },
+    { "coffee", 365, 134, 1 },
+    { "citrus_70", 365, 135, 2 },
+    { "citrus_50", 365, 137, 2 },
+    { "apple_nogc", 210, 139, 2 },
+    { "apple_gc", 210, 141, 2 },
+    { "peach_nogc", 210, 143, 2 },
+    { "olive", 270, 145, 2 },
+    { "walnut", 190, 147, 2 },
+};
+constexpr int CROP_TABLE_LEN = 76;
+
+// Linear scans — 76 crops / 4 soils, called once per boot
+// (or per crop change), so nothing fancier is warranted.
+// Return -1 when the key is unknown.
+inline int findCropIndex(const char* key) {
+    for (int i = 0; i < CROP_TABLE_LEN; i++)
+        if (strcmp(CROP_TABLE[i].key, key) == 0) return i;
+    return -1;
+}
+
+inline int findSoilIndex(const char* key) {
+    for (int i = 0; i < SOIL_TABLE_LEN; i++)
+        if (strcmp(SOIL_TABLE[i].key, key) == 0) return i;
+    return -1;
+}
+
+// Stage active at the given days-after-planting; falls back
+// to the crop's last stage past the end of the schedule.
+inline const CropStageRow& cropStageFor(const CropRow& crop,
+                                        int dap) {
+    int last = crop.stage_first + crop.stage_count - 1;
+    for (int i = crop.stage_first; i <= last; i++) {
+        if (dap >= CROP_STAGES[i].day_start &&
+            dap <= CROP_STAGES[i].day_end)
+            return CROP_STAGES[i];
+    }
+    return CROP_STAGES[last];
+}
+
+#endif // CROP_TABLES_H
@@ -1,17 +1,131 @@
 #include "db_manager.h"
+#include "perf_timer.h"
 #include <FS.h>
 #include <SD.h>
 
-DBManager::DBManager(const char *path)
-    : dbPath(path), db(nullptr), insertStmt(nullptr) {}
+DBManager::DBManager(const char *path) : db(nullptr), dbPath(path) {}
 
 DBManager::~DBManager() {
-  if (insertStmt)
-    sqlite3_finalize(insertStmt);
+  finalizeStatements();
+  if (dbRead)
+    sqlite3_close(dbRead);
   if (db)
     sqlite3_close(db);
 }
 
+// =============================================================================
+// PREPARED-STATEMENT CACHE
+// =============================================================================
+
+// Borrows the cached statement for (conn, sql), compiling it on first use
+// and resetting + clearing bindings on every hit.  Callers rebind and step,
+// then releaseStatement() when done, which also drops the read transaction.
+// Statements are tied to their connection (write path on db, query paths on
+// dbRead), so the connection is part of the key.  The SQL key is an owned
+// copy, so per-partition SQL built in a stack buffer is fine; when the
+// cache fills (old partitions rotating out of the query set), slots are
+// recycled round-robin.
+//
+// Four tasks reach this cache (writer, web, loop, physics), so the scan,
+// insert and eviction all happen under stmtMutex, and a borrowed entry is
+// pinned (`inUse`) until released: two tasks asking for the same SQL at
+// once get two distinct statements (the second becomes a duplicate cache
+// entry), and eviction never finalizes a statement another task is
+// stepping.
+sqlite3_stmt *DBManager::getStatement(sqlite3 *conn, const char *sql) {
+  if (stmtMutex)
+    xSemaphoreTake(stmtMutex, portMAX_DELAY);
+
+  int firstFree = -1;
+  for (int i = 0; i < STMT_CACHE_SIZE; i++) {
+    if (!stmtCache[i].sql) {
+      if (firstFree < 0)
+        firstFree = i;
+      continue;
+    }
+    if (!stmtCache[i].inUse && stmtCache[i].conn == conn &&
+        strcmp(stmtCache[i].sql, sql) == 0) {
+      stmtCache[i].inUse = true;
+      if (stmtMutex)
+        xSemaphoreGive(stmtMutex);
+      sqlite3_reset(stmtCache[i].stmt);
+      sqlite3_clear_bindings(stmtCache[i].stmt);
+      return stmtCache[i].stmt;
+    }
+  }
+
+  sqlite3_stmt *stmt = nullptr;
+  if (sqlite3_prepare_v2(conn, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+    Serial.printf("[DB] Prepare failed: %s\n", sqlite3_errmsg(conn));
+    if (stmtMutex)
+      xSemaphoreGive(stmtMutex);
+    return nullptr;
+  }
+
+  if (firstFree < 0) {
+    // Cache full — evict round-robin (typically a query against a partition
+    // that has since rotated out of the hot set), skipping pinned entries.
+    for (int tries = 0; tries < STMT_CACHE_SIZE; tries++) {
+      int cand = stmtRecycleIdx;
+      stmtRecycleIdx = (stmtRecycleIdx + 1) % STMT_CACHE_SIZE;
+      if (!stmtCache[cand].inUse) {
+        firstFree = cand;
+        break;
+      }
+    }
+    if (firstFree < 0) {
+      // Every slot is mid-borrow (can't happen with 4 tasks and 32 slots).
+      // Hand the statement out uncached; releaseStatement finalizes it.
+      if (stmtMutex)
+        xSemaphoreGive(stmtMutex);
+      Serial.println("[DB] WARN: statement cache fully pinned");
+      return stmt;
+    }
+    sqlite3_finalize(stmtCache[firstFree].stmt);
+    free(stmtCache[firstFree].sql);
+  }
+  stmtCache[firstFree].conn = conn;
+  stmtCache[firstFree].sql = strdup(sql);
+  stmtCache[firstFree].stmt = stmt;
+  stmtCache[firstFree].inUse = true;
+  if (stmtMutex)
+    xSemaphoreGive(stmtMutex);
+  return stmt;
+}
+
+// Returns a borrowed statement to the cache: resets it (releasing any read
+// lock) and unpins the slot.  Statements that overflowed the cache have no
+// slot and are finalized here instead.
+void DBManager::releaseStatement(sqlite3_stmt *stmt) {
+  if (!stmt)
+    return;
+  sqlite3_reset(stmt);
+  if (stmtMutex)
+    xSemaphoreTake(stmtMutex, portMAX_DELAY);
+  for (int i = 0; i < STMT_CACHE_SIZE; i++) {
+    if (stmtCache[i].stmt == stmt) {
+      stmtCache[i].inUse = false;
+      if (stmtMutex)
+        xSemaphoreGive(stmtMutex);
+      return;
+    }
+  }
+  if (stmtMutex)
+    xSemaphoreGive(stmtMutex);
+  sqlite3_finalize(stmt);   // uncached overflow borrow
+}
+
+void DBManager::finalizeStatements() {
+  for (int i = 0; i < STMT_CACHE_SIZE; i++) {
+    if (stmtCache[i].stmt)
+      sqlite3_finalize(stmtCache[i].stmt);
+    free(stmtCache[i].sql);
+    stmtCache[i].conn = nullptr;
+    stmtCache[i].sql = nullptr;
+    stmtCache[i].stmt = nullptr;
+  }
+}
+
 // =============================================================================
 // SCHEMA MIGRATION
 // =============================================================================
@@ -85,6 +199,13 @@ static void migrateTable(sqlite3 *db, const char *table, const ColDef *cols,
   }
 }
 
+// Bump whenever the DDL below or a migrateTable column list changes.  A
+// database stamped with the current version skips the CREATE/PRAGMA
+// table_info/ALTER pass entirely on boot — brownout-prone solar hubs
+// reboot often, and those scans are seconds of SD I/O that only ever do
+// work once per firmware upgrade.
+static const int DB_SCHEMA_VERSION = 1;
+
 bool DBManager::init() {
   // 1. Open Database
   int rc = sqlite3_open(dbPath, &db);
@@ -97,6 +218,34 @@ bool DBManager::init() {
   executeSQL("PRAGMA journal_mode=WAL;");
   executeSQL("PRAGMA synchronous=NORMAL;");
 
+  // Statement-cache lock — must exist before the first getStatement call
+  // (loadDeviceRegistry queries last-seen right after init returns).
+  if (!stmtMutex)
+    stmtMutex = xSemaphoreCreateMutex();
+
+  // 2a. Schema-version gate: when the stored version already matches,
+  //     the schema is exactly what this firmware created last time, so
+  //     skip straight to partition discovery.  Fresh databases report
+  //     user_version 0 and take the full path below, as do databases
+  //     from older firmware.
+  int schemaVersion = 0;
+  {
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, "PRAGMA user_version", -1, &stmt, nullptr) ==
+        SQLITE_OK) {
+      if (sqlite3_step(stmt) == SQLITE_ROW)
+        schemaVersion = sqlite3_column_int(stmt, 0);
+      sqlite3_finalize(stmt);
+    }
+  }
+  if (schemaVersion == DB_SCHEMA_VERSION) {
+    Serial.printf("[DB] Schema v%d current — fast boot\n", schemaVersion);
+    return initConnections();
+  }
+  if (schemaVersion != 0)
+    Serial.printf("[DB] Schema v%d -> v%d — running migration\n",
+                  schemaVersion, DB_SCHEMA_VERSION);
+
   // 3. Create Tables
   // NOTE: id is AUTOINCREMENT primary key — timestamp is NOT unique
   // Multiple readings per second are allowed (sensor loop runs fast)
@@ -113,6 +262,13 @@ bool DBManager::init() {
       "device_id TEXT DEFAULT 'HUB_ONBOARD', battery_pct INTEGER DEFAULT -1);"
       "CREATE INDEX IF NOT EXISTS idx_timestamp ON samples(timestamp);"
       "CREATE UNIQUE INDEX IF NOT EXISTS idx_unique_sample ON samples(device_id, timestamp, seq);"
+      // Per-device reads filter on device_id and order by timestamp DESC;
+      // neither idx_timestamp nor the unique index (which continues with
+      // seq) serves that, so give the planner a direct descent.  The
+      // (timestamp, theta) index covers the range-chart projection so that
+      // scan never touches the main B-tree.
+      "CREATE INDEX IF NOT EXISTS idx_dev_ts ON samples(device_id, timestamp DESC);"
+      "CREATE INDEX IF NOT EXISTS idx_ts_theta ON samples(timestamp, theta);"
       "CREATE TABLE IF NOT EXISTS calibration ("
       "version INTEGER PRIMARY KEY AUTOINCREMENT, timestamp INTEGER, state "
       "TEXT, "
@@ -122,6 +278,28 @@ bool DBManager::init() {
   if (!executeSQL(tableSQL))
     return false;
 
+  // 3a. Continuous-aggregate rollup tables.  Maintained incrementally inside
+  //     writeSampleBatch's transaction (see rollupSample), so long-range
+  //     series queries touch a few hundred rollup rows instead of scanning
+  //     tens of thousands of raw samples off SD.  Averages are derived from
+  //     the stored sums at read time.
+  const char *rollupSQL =
+      "CREATE TABLE IF NOT EXISTS rollup_hourly ("
+      "device_id TEXT NOT NULL, bucket INTEGER NOT NULL, n INTEGER NOT NULL, "
+      "theta_min REAL, theta_max REAL, theta_sum REAL, theta_last REAL, "
+      "temp_min REAL, temp_max REAL, temp_sum REAL, temp_last REAL, "
+      "psi_min REAL, psi_max REAL, psi_sum REAL, psi_last REAL, "
+      "PRIMARY KEY (device_id, bucket)) WITHOUT ROWID;"
+      "CREATE TABLE IF NOT EXISTS rollup_daily ("
+      "device_id TEXT NOT NULL, bucket INTEGER NOT NULL, n INTEGER NOT NULL, "
+      "theta_min REAL, theta_max REAL, theta_sum REAL, theta_last REAL, "
+      "temp_min REAL, temp_max REAL, temp_sum REAL, temp_last REAL, "
+      "psi_min REAL, psi_max REAL, psi_sum REAL, psi_last REAL, "
+      "PRIMARY KEY (device_id, bucket)) WITHOUT ROWID;";
+
+  if (!executeSQL(rollupSQL))
+    return false;
+
   // 3b. Schema migration — fallback for databases created before the current
   //     schema.  Fresh databases already have all columns from CREATE TABLE
   //     above, so migrateTable will find every column present and run zero
@@ -163,279 +341,966 @@ bool DBManager::init() {
   migrateTable(db, "calibration", calibCols,
                sizeof(calibCols) / sizeof(calibCols[0]));
 
-  // 4. Prepare Statements
-  return prepareStatements();
+  // 3c. Segment-log index: one row per segment file, maintained inside the
+  //     batch-write transaction.  Range queries use start_ts/end_ts to pick
+  //     which files to stream; `sealed` marks segments the writer has
+  //     rotated away from (only those are retention candidates).
+  const char *segDDL = "CREATE TABLE IF NOT EXISTS segments ("
+                       "id INTEGER PRIMARY KEY, file TEXT NOT NULL, "
+                       "start_ts INTEGER, end_ts INTEGER, "
+                       "rows INTEGER DEFAULT 0, sealed INTEGER DEFAULT 0);";
+  if (!executeSQL(segDDL))
+    return false;
+
+  // 3d. Per-device status, persisted lazily from the RAM registry (at most
+  //     once a minute per device).  Turns the boot-time last-seen seeding
+  //     into a primary-key probe instead of a segment/partition scan.
+  const char *statusDDL = "CREATE TABLE IF NOT EXISTS device_status ("
+                          "mac TEXT PRIMARY KEY, last_seen INTEGER, "
+                          "battery_pct INTEGER DEFAULT -1) WITHOUT ROWID;";
+  if (!executeSQL(statusDDL))
+    return false;
+
+  // 4. Backfill the per-device and covering indexes onto partitions that
+  //    predate them — ensurePartition only runs DDL when it creates a new
+  //    week, so existing tables never see schema additions otherwise.
+  //    Needs the partition list; initConnections() rediscovers it (cheap
+  //    sqlite_master scan) so the fast path gets it too.
+  loadPartitions();
+  for (int i = 0; i < partitionCount; i++) {
+    char ddl[256];
+    snprintf(ddl, sizeof(ddl),
+             "CREATE INDEX IF NOT EXISTS idx_%s_dev "
+             "ON %s(device_id, timestamp DESC);"
+             "CREATE INDEX IF NOT EXISTS idx_%s_tth "
+             "ON %s(timestamp, theta);",
+             partitions[i].name, partitions[i].name, partitions[i].name,
+             partitions[i].name);
+    executeSQL(ddl);
+  }
+
+  // Migration complete — stamp the version so the next boot takes the
+  // fast path.  Stamped last: a brownout mid-migration leaves the old
+  // version and the whole (idempotent) pass reruns.
+  char stamp[48];
+  snprintf(stamp, sizeof(stamp), "PRAGMA user_version = %d",
+           DB_SCHEMA_VERSION);
+  executeSQL(stamp);
+
+  return initConnections();
 }
 
-bool DBManager::prepareStatements() {
-  // Explicitly list columns — id is excluded, SQLite fills it automatically
-  const char *sql =
-      "INSERT OR REPLACE INTO samples "
-      "(timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
-      "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, "
-      "status, urgency, confidence, qc_valid, seq, air_temp_c, humidity, "
-      "raw_adc_2, theta_2, device_id, battery_pct) "
-      "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
-      "?)";
+// Boot steps common to the fast and migration paths: partition discovery,
+// segment-log resume and the read-only query connection.  Runs no DDL.
+bool DBManager::initConnections() {
+  // 4. Discover existing weekly partitions
+  loadPartitions();
 
-  int rc = sqlite3_prepare_v2(db, sql, -1, &insertStmt, nullptr);
-  if (rc != SQLITE_OK) {
-    Serial.printf("Prepare Error: %s\n", sqlite3_errmsg(db));
-    return false;
+  // 5. Open the append-only segment log — the hot write path for raw
+  //    samples (see segment_log.h).  Resume the unsealed segment from the
+  //    previous boot if the index still points at one.
+  uint32_t segId = 1;
+  bool resume = false;
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db,
+                         "SELECT id, sealed FROM segments "
+                         "ORDER BY id DESC LIMIT 1",
+                         -1, &stmt, nullptr) == SQLITE_OK) {
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      uint32_t lastId = (uint32_t)sqlite3_column_int(stmt, 0);
+      bool sealed = sqlite3_column_int(stmt, 1) != 0;
+      segId = sealed ? lastId + 1 : lastId;
+      resume = !sealed;
+    }
+    sqlite3_finalize(stmt);
+  }
+  segReady = segLog.begin("/segments", segId, resume);
+  if (!segReady)
+    Serial.println("[DB] WARN: segment log unavailable — raw samples will "
+                   "use SQLite inserts");
+
+  // 6. Read-only connection for the query paths.  Opened last so the
+  //    schema (including anything migrateTable added) exists before the
+  //    first read.  A short busy timeout covers the rare schema-change
+  //    window (new weekly partition) instead of surfacing SQLITE_BUSY to
+  //    a handler.
+  if (sqlite3_open_v2(dbPath, &dbRead, SQLITE_OPEN_READONLY, nullptr) !=
+      SQLITE_OK) {
+    Serial.printf("[DB] WARN: read connection failed (%s) — reads share "
+                  "the writer connection\n",
+                  dbRead ? sqlite3_errmsg(dbRead) : "out of memory");
+    if (dbRead) {
+      sqlite3_close(dbRead);
+      dbRead = nullptr;
+    }
+  } else {
+    sqlite3_busy_timeout(dbRead, 250);
   }
   return true;
 }
 
+// =============================================================================
+// WEEKLY PARTITIONS
+// =============================================================================
+// Samples are stored in one table per week bucket (samples_YYYYWW,
+// WW = tm_yday/7).  Retention drops whole tables instead of DELETE-ing
+// millions of rows through the WAL; the original `samples` table remains as
+// a read-only legacy partition for pre-partitioning data.
+
+static const time_t WEEK_SECONDS = 7 * 86400;
+
+// Shared SELECT column list — every reader uses the same order, which
+// fillRowView() below depends on.
+static const char *SAMPLE_COLS =
+    "id, timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
+    "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, status, "
+    "urgency, confidence, qc_valid, seq, air_temp_c, humidity, "
+    "raw_adc_2, theta_2, device_id, battery_pct";
+
+time_t DBManager::yearStartEpoch(int year) {
+  // Days from 1970-01-01 to year-01-01 (proleptic Gregorian)
+  auto leapsBefore = [](int y) { return (y - 1) / 4 - (y - 1) / 100 + (y - 1) / 400; };
+  long days = (long)(year - 1970) * 365 + (leapsBefore(year) - leapsBefore(1970));
+  return (time_t)days * 86400;
+}
+
+int DBManager::partitionKeyFor(time_t ts, time_t *startOut) {
+  struct tm tmv;
+  gmtime_r(&ts, &tmv);
+  int year = tmv.tm_year + 1900;
+  int week = tmv.tm_yday / 7;   // 0..52, aligned to Jan 1
+  if (startOut)
+    *startOut = yearStartEpoch(year) + (time_t)week * WEEK_SECONDS;
+  return year * 100 + week;
+}
+
+void DBManager::loadPartitions() {
+  partitionCount = 0;
+  lastPartitionIdx = -1;
+  // Zero-padded names sort chronologically, so ORDER BY name gives the
+  // partition list oldest-first.
+  const char *sql = "SELECT name FROM sqlite_master WHERE type='table' "
+                    "AND name GLOB 'samples_[0-9]*' ORDER BY name";
+  sqlite3_stmt *stmt;
+  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK)
+    return;
+  while (sqlite3_step(stmt) == SQLITE_ROW && partitionCount < MAX_PARTITIONS) {
+    const char *name = (const char *)sqlite3_column_text(stmt, 0);
+    if (!name || strlen(name) != 14)   // "samples_" + YYYYWW
+      continue;
+    int year, week;
+    if (sscanf(name + 8, "%4d%2d", &year, &week) != 2)
+      continue;
+    Partition &p = partitions[partitionCount];
+    p.key = year * 100 + week;
+    p.startTs = yearStartEpoch(year) + (time_t)week * WEEK_SECONDS;
+    snprintf(p.name, sizeof(p.name), "%s", name);
+    partitionCount++;
+  }
+  sqlite3_finalize(stmt);
+  Serial.printf("[DB] %d weekly partition(s) found\n", partitionCount);
+}
+
+// Returns the table name for the row's week bucket, creating the table (and
+// its indexes) on first use.  Fast path: consecutive rows nearly always land
+// in the same bucket.
+const char *DBManager::ensurePartition(time_t ts) {
+  time_t start;
+  int key = partitionKeyFor(ts, &start);
+  if (lastPartitionIdx >= 0 && partitions[lastPartitionIdx].key == key)
+    return partitions[lastPartitionIdx].name;
+  for (int i = partitionCount - 1; i >= 0; i--) {
+    if (partitions[i].key == key) {
+      lastPartitionIdx = i;
+      return partitions[i].name;
+    }
+  }
+  if (partitionCount >= MAX_PARTITIONS) {
+    // Retention should drop old partitions long before this; fall back to
+    // the legacy table rather than dropping data.
+    Serial.println("[DB] WARN: partition table full — writing to legacy");
+    return "samples";
+  }
+
+  char name[20];
+  // Modulo bounds the fields so the name provably fits its buffer.
+  snprintf(name, sizeof(name), "samples_%04u%02u",
+           (unsigned)(key / 100) % 10000u, (unsigned)key % 100u);
+  char ddl[1536];
+  snprintf(ddl, sizeof(ddl),
+           "CREATE TABLE IF NOT EXISTS %s ("
+           "id INTEGER PRIMARY KEY AUTOINCREMENT, "
+           "timestamp INTEGER NOT NULL, "
+           "raw_adc INTEGER, temp_c REAL, theta REAL, "
+           "theta_fc REAL, theta_refill REAL, psi_kpa REAL, aw_mm REAL, "
+           "fraction_depleted REAL, drying_rate REAL, regime TEXT, "
+           "status TEXT, urgency TEXT, confidence REAL, qc_valid INTEGER, "
+           "seq INTEGER, air_temp_c REAL DEFAULT -1, "
+           "humidity REAL DEFAULT -1, raw_adc_2 INTEGER DEFAULT -1, "
+           "theta_2 REAL DEFAULT -1, device_id TEXT DEFAULT 'HUB_ONBOARD', "
+           "battery_pct INTEGER DEFAULT -1);"
+           "CREATE INDEX IF NOT EXISTS idx_%s_ts ON %s(timestamp);"
+           "CREATE UNIQUE INDEX IF NOT EXISTS idx_%s_uniq "
+           "ON %s(device_id, timestamp, seq);"
+           "CREATE INDEX IF NOT EXISTS idx_%s_dev "
+           "ON %s(device_id, timestamp DESC);"
+           "CREATE INDEX IF NOT EXISTS idx_%s_tth "
+           "ON %s(timestamp, theta);",
+           name, name, name, name, name, name, name, name, name);
+  if (!executeSQL(ddl))
+    return "samples";
+
+  // Insert sorted by key (new weeks are almost always newest)
+  int pos = partitionCount;
+  while (pos > 0 && partitions[pos - 1].key > key) {
+    partitions[pos] = partitions[pos - 1];
+    pos--;
+  }
+  partitions[pos].key = key;
+  partitions[pos].startTs = start;
+  snprintf(partitions[pos].name, sizeof(partitions[pos].name), "%s", name);
+  partitionCount++;
+  lastPartitionIdx = pos;
+  Serial.printf("[DB] Created partition %s\n", name);
+  return partitions[pos].name;
+}
+
+int DBManager::queryTables(const char *out[], int maxOut) {
+  int n = 0;
+  for (int i = partitionCount - 1; i >= 0 && n < maxOut; i--)
+    out[n++] = partitions[i].name;
+  if (n < maxOut)
+    out[n++] = "samples";   // legacy pre-partitioning data, oldest
+  return n;
+}
+
+// Single-row insert into the row's weekly partition — the fallback path
+// when the segment log is unavailable or an append fails.
+void DBManager::insertSampleRow(const SampleData &s) {
+  const char *table = ensurePartition(s.timestamp);
+  char sql[512];
+  snprintf(sql, sizeof(sql),
+           "INSERT OR REPLACE INTO %s "
+           "(timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
+           "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, "
+           "status, urgency, confidence, qc_valid, seq, air_temp_c, "
+           "humidity, raw_adc_2, theta_2, device_id, battery_pct) "
+           "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+           "?, ?, ?, ?)",
+           table);
+  sqlite3_stmt *insert = getStatement(db, sql);
+  if (!insert)
+    return;
+
+  sqlite3_bind_int64(insert, 1, s.timestamp);
+  sqlite3_bind_int(insert, 2, s.raw_adc);
+  sqlite3_bind_double(insert, 3, s.temp_c);
+  sqlite3_bind_double(insert, 4, s.theta);
+  sqlite3_bind_double(insert, 5, s.theta_fc);
+  sqlite3_bind_double(insert, 6, s.theta_refill);
+  sqlite3_bind_double(insert, 7, s.psi_kpa);
+  sqlite3_bind_double(insert, 8, s.aw_mm);
+  sqlite3_bind_double(insert, 9, s.fraction_depleted);
+  sqlite3_bind_double(insert, 10, s.drying_rate);
+  sqlite3_bind_text(insert, 11, s.regime, -1, SQLITE_STATIC);
+  sqlite3_bind_text(insert, 12, s.status, -1, SQLITE_STATIC);
+  sqlite3_bind_text(insert, 13, s.urgency, -1, SQLITE_STATIC);
+  sqlite3_bind_double(insert, 14, s.confidence);
+  sqlite3_bind_int(insert, 15, s.qc_valid ? 1 : 0);
+  sqlite3_bind_int(insert, 16, s.seq);
+  sqlite3_bind_double(insert, 17, s.air_temp_c);
+  sqlite3_bind_double(insert, 18, s.humidity);
+  sqlite3_bind_int(insert, 19, s.raw_adc_2);
+  sqlite3_bind_double(insert, 20, s.theta_2);
+  sqlite3_bind_text(insert, 21, s.device_id, -1, SQLITE_STATIC);
+  sqlite3_bind_int(insert, 22, s.battery_pct);
+
+  if (sqlite3_step(insert) != SQLITE_DONE) {
+    Serial.printf("Insert Step Error: %s\n", sqlite3_errmsg(db));
+  }
+  releaseStatement(insert);
+}
+
+// Upserts the active segment's index row after a batch: widens the time
+// range and bumps the row count.  Runs inside the batch transaction.
+void DBManager::updateSegmentIndex(time_t t0, time_t t1, int rows) {
+  static const char *sql =
+      "INSERT INTO segments (id, file, start_ts, end_ts, rows, sealed) "
+      "VALUES (?1, ?2, ?3, ?4, ?5, 0) "
+      "ON CONFLICT(id) DO UPDATE SET start_ts = MIN(start_ts, ?3), "
+      "end_ts = MAX(end_ts, ?4), rows = rows + ?5";
+  sqlite3_stmt *stmt = getStatement(db, sql);
+  if (!stmt)
+    return;
+  char path[48];
+  segLog.pathFor(segLog.activeId(), path, sizeof(path));
+  sqlite3_bind_int(stmt, 1, (int)segLog.activeId());
+  sqlite3_bind_text(stmt, 2, path, -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 3, t0);
+  sqlite3_bind_int64(stmt, 4, t1);
+  sqlite3_bind_int(stmt, 5, rows);
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    Serial.printf("[DB] Segment index error: %s\n", sqlite3_errmsg(db));
+  releaseStatement(stmt);
+}
+
+void DBManager::sealActiveSegment() {
+  char sql[64];
+  snprintf(sql, sizeof(sql), "UPDATE segments SET sealed = 1 WHERE id = %lu",
+           (unsigned long)segLog.activeId());
+  executeSQL(sql);
+  segLog.rotate(segLog.activeId() + 1);
+}
+
 bool DBManager::writeSampleBatch(std::vector<SampleData> &samples) {
   if (samples.empty())
     return true;
 
+  PERF_SCOPE("db.write_batch");
+
   executeSQL("BEGIN TRANSACTION;");
 
-  for (const auto &s : samples) {
-    sqlite3_reset(insertStmt);
-
-    // Binds map to: timestamp=1, raw_adc=2, temp_c=3, theta=4, theta_fc=5,
-    // theta_refill=6, psi_kpa=7, aw_mm=8, fraction_depleted=9, drying_rate=10,
-    // regime=11, status=12, urgency=13, confidence=14, qc_valid=15, seq=16,
-    // air_temp_c=17
-    sqlite3_bind_int64(insertStmt, 1, s.timestamp);
-    sqlite3_bind_int(insertStmt, 2, s.raw_adc);
-    sqlite3_bind_double(insertStmt, 3, s.temp_c);
-    sqlite3_bind_double(insertStmt, 4, s.theta);
-    sqlite3_bind_double(insertStmt, 5, s.theta_fc);
-    sqlite3_bind_double(insertStmt, 6, s.theta_refill);
-    sqlite3_bind_double(insertStmt, 7, s.psi_kpa);
-    sqlite3_bind_double(insertStmt, 8, s.aw_mm);
-    sqlite3_bind_double(insertStmt, 9, s.fraction_depleted);
-    sqlite3_bind_double(insertStmt, 10, s.drying_rate);
-    sqlite3_bind_text(insertStmt, 11, s.regime.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertStmt, 12, s.status.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_text(insertStmt, 13, s.urgency.c_str(), -1, SQLITE_STATIC);
-    sqlite3_bind_double(insertStmt, 14, s.confidence);
-    sqlite3_bind_int(insertStmt, 15, s.qc_valid ? 1 : 0);
-    sqlite3_bind_int(insertStmt, 16, s.seq);
-    sqlite3_bind_double(insertStmt, 17, s.air_temp_c);
-    sqlite3_bind_double(insertStmt, 18, s.humidity);
-    sqlite3_bind_int(insertStmt, 19, s.raw_adc_2);
-    sqlite3_bind_double(insertStmt, 20, s.theta_2);
-    sqlite3_bind_text(insertStmt, 21, s.device_id.c_str(), -1,
-                      SQLITE_TRANSIENT);
-    sqlite3_bind_int(insertStmt, 22, s.battery_pct);
-
-    if (sqlite3_step(insertStmt) != SQLITE_DONE) {
-      Serial.printf("Insert Step Error: %s\n", sqlite3_errmsg(db));
+  if (segReady) {
+    // Hot path: group the batch per device (preserving each device's
+    // arrival order, which is time-ascending) and append one columnar
+    // block per group.  SQLite sees only the rollup upserts and one
+    // segments-index upsert — no per-row insert, no B-tree rebalancing.
+    size_t n = samples.size();
+    std::vector<uint8_t> used(n, 0);
+    time_t t0 = 0, t1 = 0;
+    int appended = 0;
+    // Single-writer scratch (writer task, or the synchronous fallback
+    // before it starts) — keeps ~2 KB off the task stack.
+    static SampleData group[SegmentLog::BLOCK_MAX_ROWS];
+    for (size_t i = 0; i < n; i++) {
+      if (used[i])
+        continue;
+      int cnt = 0;
+      for (size_t j = i; j < n && cnt < SegmentLog::BLOCK_MAX_ROWS; j++) {
+        if (used[j] ||
+            strcmp(samples[j].device_id, samples[i].device_id) != 0)
+          continue;
+        group[cnt++] = samples[j];
+        used[j] = 1;
+      }
+      if (segLog.appendBlock(group, cnt)) {
+        for (int k = 0; k < cnt; k++) {
+          if (t0 == 0 || group[k].timestamp < t0)
+            t0 = group[k].timestamp;
+          if (group[k].timestamp > t1)
+            t1 = group[k].timestamp;
+          rollupSample(group[k]);
+        }
+        appended += cnt;
+      } else {
+        // SD append failed — keep the rows via the partitioned inserts.
+        for (int k = 0; k < cnt; k++) {
+          insertSampleRow(group[k]);
+          rollupSample(group[k]);
+        }
+      }
+    }
+    if (appended > 0)
+      updateSegmentIndex(t0, t1, appended);
+  } else {
+    for (const auto &s : samples) {
+      insertSampleRow(s);
+      // Maintain the hourly/daily rollups in the same transaction so the
+      // aggregates can never drift from the raw data.
+      rollupSample(s);
     }
   }
 
   executeSQL("COMMIT;");
+
+  if (segReady) {
+    segLog.flush();
+    if (segLog.needsRotation())
+      sealActiveSegment();
+  }
   return true;
 }
 
-SampleData DBManager::getLatestSample() {
-  SampleData s = {};
-  sqlite3_stmt *stmt;
-  const char *sql = "SELECT * FROM samples ORDER BY timestamp DESC LIMIT 1";
+// =============================================================================
+// CONTINUOUS AGGREGATES
+// =============================================================================
+
+// One upsert per rollup table: the first row of a bucket seeds min/max/sum/
+// last from the sample; subsequent rows fold into the running aggregates.
+// ?3/?4/?5 are reused across the VALUES and DO UPDATE clauses so only five
+// binds are needed per call.
+static const char *ROLLUP_HOURLY_SQL =
+    "INSERT INTO rollup_hourly (device_id, bucket, n, "
+    "theta_min, theta_max, theta_sum, theta_last, "
+    "temp_min, temp_max, temp_sum, temp_last, "
+    "psi_min, psi_max, psi_sum, psi_last) "
+    "VALUES (?1, ?2, 1, ?3, ?3, ?3, ?3, ?4, ?4, ?4, ?4, ?5, ?5, ?5, ?5) "
+    "ON CONFLICT(device_id, bucket) DO UPDATE SET n = n + 1, "
+    "theta_min = MIN(theta_min, ?3), theta_max = MAX(theta_max, ?3), "
+    "theta_sum = theta_sum + ?3, theta_last = ?3, "
+    "temp_min = MIN(temp_min, ?4), temp_max = MAX(temp_max, ?4), "
+    "temp_sum = temp_sum + ?4, temp_last = ?4, "
+    "psi_min = MIN(psi_min, ?5), psi_max = MAX(psi_max, ?5), "
+    "psi_sum = psi_sum + ?5, psi_last = ?5";
+
+static const char *ROLLUP_DAILY_SQL =
+    "INSERT INTO rollup_daily (device_id, bucket, n, "
+    "theta_min, theta_max, theta_sum, theta_last, "
+    "temp_min, temp_max, temp_sum, temp_last, "
+    "psi_min, psi_max, psi_sum, psi_last) "
+    "VALUES (?1, ?2, 1, ?3, ?3, ?3, ?3, ?4, ?4, ?4, ?4, ?5, ?5, ?5, ?5) "
+    "ON CONFLICT(device_id, bucket) DO UPDATE SET n = n + 1, "
+    "theta_min = MIN(theta_min, ?3), theta_max = MAX(theta_max, ?3), "
+    "theta_sum = theta_sum + ?3, theta_last = ?3, "
+    "temp_min = MIN(temp_min, ?4), temp_max = MAX(temp_max, ?4), "
+    "temp_sum = temp_sum + ?4, temp_last = ?4, "
+    "psi_min = MIN(psi_min, ?5), psi_max = MAX(psi_max, ?5), "
+    "psi_sum = psi_sum + ?5, psi_last = ?5";
+
+void DBManager::upsertRollup(const char *sql, time_t bucket,
+                             const SampleData &s) {
+  sqlite3_stmt *stmt = getStatement(db, sql);
+  if (!stmt)
+    return;
+  sqlite3_bind_text(stmt, 1, s.device_id, -1, SQLITE_STATIC);
+  sqlite3_bind_int64(stmt, 2, bucket);
+  sqlite3_bind_double(stmt, 3, s.theta);
+  sqlite3_bind_double(stmt, 4, s.temp_c);
+  sqlite3_bind_double(stmt, 5, s.psi_kpa);
+  if (sqlite3_step(stmt) != SQLITE_DONE)
+    Serial.printf("[DB] Rollup step error: %s\n", sqlite3_errmsg(db));
+  releaseStatement(stmt);
+}
+
+void DBManager::rollupSample(const SampleData &s) {
+  // Skip placeholder rows (no soil sensor) — a -1 theta would poison the
+  // bucket minima.
+  if (s.theta < 0.0f)
+    return;
+  upsertRollup(ROLLUP_HOURLY_SQL, s.timestamp - (s.timestamp % 3600), s);
+  upsertRollup(ROLLUP_DAILY_SQL, s.timestamp - (s.timestamp % 86400), s);
+}
+
+std::vector<DBManager::SeriesPoint>
+DBManager::getSeriesAggregated(time_t start, time_t end, int resolution_s,
+                               const String &deviceId) {
+  std::vector<SeriesPoint> res;
+  // Limits match a month of hours / a year of days — same memory-overflow
+  // guard as getSamplesInRange.
+  static const char *hourlySQL =
+      "SELECT bucket, n, theta_min, theta_max, theta_sum, theta_last, "
+      "temp_min, temp_max, temp_sum, psi_min, psi_max, psi_sum "
+      "FROM rollup_hourly WHERE device_id = ? AND bucket BETWEEN ? AND ? "
+      "ORDER BY bucket ASC LIMIT 744";
+  static const char *dailySQL =
+      "SELECT bucket, n, theta_min, theta_max, theta_sum, theta_last, "
+      "temp_min, temp_max, temp_sum, psi_min, psi_max, psi_sum "
+      "FROM rollup_daily WHERE device_id = ? AND bucket BETWEEN ? AND ? "
+      "ORDER BY bucket ASC LIMIT 366";
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+  const char *sql = (resolution_s >= 86400) ? dailySQL : hourlySQL;
+  sqlite3_stmt *stmt = getStatement(readDb(), sql);
+  if (stmt) {
+    sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, start);
+    sqlite3_bind_int64(stmt, 3, end);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      SeriesPoint p = {};
+      p.bucket = sqlite3_column_int64(stmt, 0);
+      p.n = sqlite3_column_int(stmt, 1);
+      float inv_n = (p.n > 0) ? 1.0f / p.n : 0.0f;
+      p.theta_min = sqlite3_column_double(stmt, 2);
+      p.theta_max = sqlite3_column_double(stmt, 3);
+      p.theta_avg = sqlite3_column_double(stmt, 4) * inv_n;
+      p.theta_last = sqlite3_column_double(stmt, 5);
+      p.temp_min = sqlite3_column_double(stmt, 6);
+      p.temp_max = sqlite3_column_double(stmt, 7);
+      p.temp_avg = sqlite3_column_double(stmt, 8) * inv_n;
+      p.psi_min = sqlite3_column_double(stmt, 9);
+      p.psi_max = sqlite3_column_double(stmt, 10);
+      p.psi_avg = sqlite3_column_double(stmt, 11) * inv_n;
+      res.push_back(p);
+    }
+  }
+  if (stmt)
+    releaseStatement(stmt);   // unpin + release the read lock
+  return res;
+}
+
+// =============================================================================
+// ASYNCHRONOUS WRITER
+// =============================================================================
+// Producers append to *fillBuf under a short mutex hold; the writer task
+// swaps fillBuf/flushBuf by pointer and runs the (slow, SD-bound) commit on
+// the buffer ingest is no longer touching.  Flushes happen when a batch has
+// accumulated or on a timeout, whichever comes first.
+
+static const int WRITER_BATCH_SIZE = 8;
+static const TickType_t WRITER_FLUSH_TICKS = pdMS_TO_TICKS(5000);
+
+bool DBManager::startWriter() {
+  if (writerTask)
+    return true;
+  bufMutex = xSemaphoreCreateMutex();
+  if (!bufMutex)
+    return false;
+  bufA.reserve(WRITER_BATCH_SIZE * 2);
+  bufB.reserve(WRITER_BATCH_SIZE * 2);
+  BaseType_t ok = xTaskCreate(writerTaskEntry, "db_writer", 6144, this,
+                              1 /* low priority — SD-bound */, &writerTask);
+  return ok == pdPASS;
+}
+
+void DBManager::queueSample(const SampleData &s) {
+  if (!bufMutex) {
+    // Writer not started — fall back to a synchronous single-row batch
+    std::vector<SampleData> one = {s};
+    writeSampleBatch(one);
+    return;
+  }
+  size_t pending = 0;
+  xSemaphoreTake(bufMutex, portMAX_DELAY);
+  fillBuf->push_back(s);
+  pending = fillBuf->size();
+  xSemaphoreGive(bufMutex);
+  if (pending >= WRITER_BATCH_SIZE && writerTask)
+    xTaskNotifyGive(writerTask);
+}
+
+void DBManager::flushQueued() {
+  if (!bufMutex)
+    return;
+  xSemaphoreTake(bufMutex, portMAX_DELAY);
+  std::swap(fillBuf, flushBuf);
+  xSemaphoreGive(bufMutex);
+  if (!flushBuf->empty()) {
+    writeSampleBatch(*flushBuf);
+    flushBuf->clear();
+  }
+}
+
+void DBManager::writerTaskEntry(void *self) {
+  static_cast<DBManager *>(self)->writerLoop();
+}
+
+void DBManager::writerLoop() {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, WRITER_FLUSH_TICKS);
+    flushQueued();
+  }
+}
+
+// =============================================================================
+// ROW-VISITOR QUERY API
+// =============================================================================
+// Column order matches SAMPLE_COLS.  The text fields are handed out
+// borrowed — they live in sqlite3's row buffer and are invalidated by the
+// next step/reset.
+
+static void fillRowView(sqlite3_stmt *stmt, DBManager::RowView &v) {
+  v.id = sqlite3_column_int(stmt, 0);
+  v.timestamp = sqlite3_column_int64(stmt, 1);
+  v.raw_adc = sqlite3_column_int(stmt, 2);
+  v.temp_c = sqlite3_column_double(stmt, 3);
+  v.theta = sqlite3_column_double(stmt, 4);
+  v.theta_fc = sqlite3_column_double(stmt, 5);
+  v.theta_refill = sqlite3_column_double(stmt, 6);
+  v.psi_kpa = sqlite3_column_double(stmt, 7);
+  v.aw_mm = sqlite3_column_double(stmt, 8);
+  v.fraction_depleted = sqlite3_column_double(stmt, 9);
+  v.drying_rate = sqlite3_column_double(stmt, 10);
+  const char *txt;
+  txt = (const char *)sqlite3_column_text(stmt, 11);
+  v.regime = txt ? txt : "";
+  txt = (const char *)sqlite3_column_text(stmt, 12);
+  v.status = txt ? txt : "";
+  txt = (const char *)sqlite3_column_text(stmt, 13);
+  v.urgency = txt ? txt : "";
+  v.confidence = sqlite3_column_double(stmt, 14);
+  v.qc_valid = sqlite3_column_int(stmt, 15) != 0;
+  v.seq = sqlite3_column_int(stmt, 16);
+  v.air_temp_c = sqlite3_column_double(stmt, 17);
+  v.humidity = sqlite3_column_double(stmt, 18);
+  v.raw_adc_2 = sqlite3_column_int(stmt, 19);
+  v.theta_2 = sqlite3_column_double(stmt, 20);
+  txt = (const char *)sqlite3_column_text(stmt, 21);
+  v.device_id = txt ? txt : "";
+  v.battery_pct = sqlite3_column_int(stmt, 22);
+}
+
+// Copies a borrowed RowView into an owning SampleData.
+static void rowViewToSample(const DBManager::RowView &v, SampleData &s) {
+  s.id = v.id;
+  s.timestamp = v.timestamp;
+  s.raw_adc = v.raw_adc;
+  s.raw_adc_2 = v.raw_adc_2;
+  s.temp_c = v.temp_c;
+  s.humidity = v.humidity;
+  s.air_temp_c = v.air_temp_c;
+  s.theta = v.theta;
+  s.theta_2 = v.theta_2;
+  s.theta_fc = v.theta_fc;
+  s.theta_refill = v.theta_refill;
+  s.psi_kpa = v.psi_kpa;
+  s.aw_mm = v.aw_mm;
+  s.fraction_depleted = v.fraction_depleted;
+  s.drying_rate = v.drying_rate;
+  s.setRegime(v.regime);
+  s.setStatus(v.status);
+  s.setUrgency(v.urgency);
+  s.confidence = v.confidence;
+  s.qc_valid = v.qc_valid;
+  s.seq = v.seq;
+  s.setDeviceId(v.device_id);
+  s.battery_pct = v.battery_pct;
+}
+
+// Borrows a RowView from an owning SampleData (segment-decoded rows) —
+// the mirror of rowViewToSample.  Valid as long as the SampleData lives.
+static void rowViewFromSample(const SampleData &s, DBManager::RowView &v) {
+  v.id = s.id;
+  v.timestamp = s.timestamp;
+  v.raw_adc = s.raw_adc;
+  v.raw_adc_2 = s.raw_adc_2;
+  v.temp_c = s.temp_c;
+  v.humidity = s.humidity;
+  v.air_temp_c = s.air_temp_c;
+  v.theta = s.theta;
+  v.theta_2 = s.theta_2;
+  v.theta_fc = s.theta_fc;
+  v.theta_refill = s.theta_refill;
+  v.psi_kpa = s.psi_kpa;
+  v.aw_mm = s.aw_mm;
+  v.fraction_depleted = s.fraction_depleted;
+  v.drying_rate = s.drying_rate;
+  v.regime = s.regime;
+  v.status = s.status;
+  v.urgency = s.urgency;
+  v.confidence = s.confidence;
+  v.qc_valid = s.qc_valid;
+  v.seq = s.seq;
+  v.device_id = s.device_id;
+  v.battery_pct = s.battery_pct;
+}
+
+// Compiles the per-table SELECT for the next table in the cursor's list.
+// Partition tables are time-disjoint and listed newest-first, so stepping
+// them in order preserves global newest-first ordering.  The per-device
+// variant descends idx_*_dev (device_id, timestamp DESC) — no sort, no
+// full index walk.
+bool DBManager::SampleCursor::openNextTable() {
+  while (tableIdx < tableCount) {
+    const char *table = tables[tableIdx++];
+    char sql[448];
+    if (devId[0] == '\0')
+      snprintf(sql, sizeof(sql),
+               "SELECT %s FROM %s ORDER BY timestamp DESC LIMIT %d",
+               SAMPLE_COLS, table, remaining);
+    else
+      snprintf(sql, sizeof(sql),
+               "SELECT %s FROM %s WHERE device_id = ? "
+               "ORDER BY timestamp DESC LIMIT %d",
+               SAMPLE_COLS, table, remaining);
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) {
+      stmt = nullptr;
+      continue;   // partition may have been dropped by retention — skip
+    }
+    if (devId[0] != '\0')
+      sqlite3_bind_text(stmt, 1, devId, -1, SQLITE_STATIC);
+    return true;
+  }
+  return false;
+}
+
+// Emits the segment stage newest-first: segment files newest-first, block
+// offsets within a file in reverse, rows within a block in reverse.  The
+// RowView borrows from rowBuf and is valid until the next call — the same
+// contract as the sqlite3-backed rows.
+bool DBManager::SampleCursor::nextSegmentRow(RowView &out) {
+  while (remaining > 0) {
+    if (rowIdx >= 0) {
+      rowViewFromSample(rowBuf[rowIdx--], out);
+      remaining--;
+      return true;
+    }
+    if (blockIdx >= 0) {
+      rowIdx = segReader.readBlockAt(blockOffs[blockIdx--], rowBuf) - 1;
+      continue;
+    }
+    segReader.close();
+    if (segIdx >= segCount)
+      return false;
+    if (!segReader.open(segPaths[segIdx++]))
+      continue;   // file may have been removed by retention — skip
+    blockIdx = segReader.scanBlocks(blockOffs, MAX_BLOCKS, devId) - 1;
+  }
+  return false;
+}
+
+bool DBManager::SampleCursor::next(RowView &out) {
+  // Segments hold the newest data — drain them before the SQLite tables.
+  if (nextSegmentRow(out))
+    return true;
+  for (;;) {
+    if (!stmt) {
+      if (remaining <= 0 || !openNextTable())
+        return false;
+    }
     if (sqlite3_step(stmt) == SQLITE_ROW) {
-      // Column offsets shifted by 1 due to id being column 0
-      // col 0: id, col 1: timestamp, col 2: raw_adc, col 3: temp_c,
-      // col 4: theta, col 5: theta_fc, col 6: theta_refill, col 7: psi_kpa,
-      // col 8: aw_mm, col 9: fraction_depleted, col 10: drying_rate,
-      // col 11: regime, col 12: status, col 13: urgency, col 14: confidence,
-      // col 15: qc_valid, col 16: seq, col 17: air_temp_c
-      s.id = sqlite3_column_int(stmt, 0);
-      s.timestamp = sqlite3_column_int64(stmt, 1);
-      s.raw_adc = sqlite3_column_int(stmt, 2);
-      s.temp_c = sqlite3_column_double(stmt, 3);
-      s.theta = sqlite3_column_double(stmt, 4);
-      s.theta_fc = sqlite3_column_double(stmt, 5);
-      s.theta_refill = sqlite3_column_double(stmt, 6);
-      s.psi_kpa = sqlite3_column_double(stmt, 7);
-      s.aw_mm = sqlite3_column_double(stmt, 8);
-      s.fraction_depleted = sqlite3_column_double(stmt, 9);
-      s.drying_rate = sqlite3_column_double(stmt, 10);
-      s.regime = String((const char *)sqlite3_column_text(stmt, 11));
-      s.status = String((const char *)sqlite3_column_text(stmt, 12));
-      s.urgency = String((const char *)sqlite3_column_text(stmt, 13));
-      s.confidence = sqlite3_column_double(stmt, 14);
-      s.qc_valid = sqlite3_column_int(stmt, 15) != 0;
-      s.seq = sqlite3_column_int(stmt, 16);
-      s.air_temp_c = sqlite3_column_double(stmt, 17);
+      fillRowView(stmt, out);
+      remaining--;
+      return true;
     }
+    sqlite3_finalize(stmt);   // table exhausted — move to the next one
+    stmt = nullptr;
   }
-  sqlite3_finalize(stmt);
+}
+
+void DBManager::SampleCursor::close() {
+  if (stmt) {
+    sqlite3_finalize(stmt);
+    stmt = nullptr;
+  }
+  tableCount = 0;
+  tableIdx = 0;
+  remaining = 0;
+  segReader.close();
+  segCount = 0;
+  segIdx = 0;
+  blockIdx = -1;
+  rowIdx = -1;
+}
+
+bool DBManager::openRecentSamples(SampleCursor &cur, int n,
+                                  const String &deviceId) {
+  cur.close();
+  cur.db = readDb();
+  // Eight newest tables = eight weeks of data — far more than any recent-
+  // samples limit can span.
+  const char *tabs[SampleCursor::MAX_TABLES];
+  int cnt = queryTables(tabs, SampleCursor::MAX_TABLES);
+  for (int i = 0; i < cnt; i++)
+    snprintf(cur.tables[i], sizeof(cur.tables[i]), "%s", tabs[i]);
+  cur.tableCount = cnt;
+  cur.tableIdx = 0;
+  snprintf(cur.devId, sizeof(cur.devId), "%s", deviceId.c_str());
+  cur.remaining = n;
+  cur.segCount = listRecentSegments(cur.segPaths, SampleCursor::MAX_SEGMENTS);
+  return true;
+}
+
+// Fills paths[] with the newest segment files first; returns the count.
+int DBManager::listRecentSegments(char paths[][48], int maxOut) {
+  if (!segReady)
+    return 0;
+  sqlite3_stmt *stmt =
+      getStatement(readDb(), "SELECT file FROM segments ORDER BY id DESC LIMIT ?");
+  if (!stmt)
+    return 0;
+  sqlite3_bind_int(stmt, 1, maxOut);
+  int n = 0;
+  while (n < maxOut && sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *f = (const char *)sqlite3_column_text(stmt, 0);
+    if (f)
+      snprintf(paths[n++], 48, "%s", f);
+  }
+  releaseStatement(stmt);   // unpin + release the read lock
+  return n;
+}
+
+int DBManager::forEachSample(int n, const String &deviceId, RowVisitor visit,
+                             void *ctx) {
+  SampleCursor cur;
+  if (!openRecentSamples(cur, n, deviceId))
+    return 0;
+  int visited = 0;
+  RowView row;
+  while (cur.next(row)) {
+    visited++;
+    if (!visit(row, ctx))
+      break;
+  }
+  return visited;
+}
+
+SampleData DBManager::getLatestSample() {
+  SampleData s = {};
+  SampleCursor cur;
+  RowView row;
+  if (openRecentSamples(cur, 1, "") && cur.next(row))
+    rowViewToSample(row, s);
+  return s;
+}
+
+SampleData DBManager::getLatestSampleForDevice(const String &deviceId) {
+  SampleData s = {};
+  SampleCursor cur;
+  RowView row;
+  if (openRecentSamples(cur, 1, deviceId) && cur.next(row))
+    rowViewToSample(row, s);
   return s;
 }
 
 std::vector<SampleData> DBManager::getRecentSamples(int n) {
+  return getRecentSamples(n, "");
+}
+
+std::vector<SampleData> DBManager::getRecentSamples(int n,
+                                                    const String &deviceId) {
   std::vector<SampleData> res;
-  sqlite3_stmt *stmt;
-  const char *sql =
-      "SELECT id, timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
-      "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, status, "
-      "urgency, confidence, qc_valid, seq, air_temp_c, humidity, "
-      "raw_adc_2, theta_2, device_id, battery_pct "
-      "FROM samples ORDER BY timestamp DESC LIMIT ?";
-
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-    sqlite3_bind_int(stmt, 1, n);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-      SampleData s = {};
-      s.id = sqlite3_column_int(stmt, 0);
-      s.timestamp = sqlite3_column_int64(stmt, 1);
-      s.raw_adc = sqlite3_column_int(stmt, 2);
-      s.temp_c = sqlite3_column_double(stmt, 3);
-      s.theta = sqlite3_column_double(stmt, 4);
-      s.theta_fc = sqlite3_column_double(stmt, 5);
-      s.theta_refill = sqlite3_column_double(stmt, 6);
-      s.psi_kpa = sqlite3_column_double(stmt, 7);
-      s.aw_mm = sqlite3_column_double(stmt, 8);
-      s.fraction_depleted = sqlite3_column_double(stmt, 9);
-      s.drying_rate = sqlite3_column_double(stmt, 10);
-      s.regime = String((const char *)sqlite3_column_text(stmt, 11));
-      s.status = String((const char *)sqlite3_column_text(stmt, 12));
-      s.urgency = String((const char *)sqlite3_column_text(stmt, 13));
-      s.confidence = sqlite3_column_double(stmt, 14);
-      s.qc_valid = sqlite3_column_int(stmt, 15) != 0;
-      s.seq = sqlite3_column_int(stmt, 16);
-      s.air_temp_c = sqlite3_column_double(stmt, 17);
-      s.humidity = sqlite3_column_double(stmt, 18);
-      s.raw_adc_2 = sqlite3_column_int(stmt, 19);
-      s.theta_2 = sqlite3_column_double(stmt, 20);
-      s.device_id = String((const char *)sqlite3_column_text(stmt, 21));
-      s.battery_pct = sqlite3_column_int(stmt, 22);
-      res.push_back(s);
-    }
+  SampleCursor cur;
+  if (!openRecentSamples(cur, n, deviceId))
+    return res;
+  RowView row;
+  while (cur.next(row)) {
+    SampleData s = {};
+    rowViewToSample(row, s);
+    res.push_back(s);
   }
-  sqlite3_finalize(stmt);
   return res;
 }
 
 std::vector<SampleData> DBManager::getSamplesInRange(time_t start, time_t end) {
   std::vector<SampleData> res;
-  sqlite3_stmt *stmt;
   // Limit to 200 points to prevent memory overflow on ESP32
-  const char *sql = "SELECT timestamp, theta FROM samples WHERE timestamp "
-                    "BETWEEN ? AND ? ORDER BY timestamp ASC LIMIT 200";
+  static const int RANGE_LIMIT = 200;
 
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+  // (timestamp, theta) is exactly idx_*_tth, so this scan is index-only —
+  // no row lookups into the main B-tree.
+  auto queryTable = [&](const char *table) {
+    char sql[192];
+    snprintf(sql, sizeof(sql),
+             "SELECT timestamp, theta FROM %s WHERE timestamp "
+             "BETWEEN ? AND ? ORDER BY timestamp ASC LIMIT ?",
+             table);
+    sqlite3_stmt *stmt = getStatement(readDb(), sql);
+    if (!stmt)
+      return;
     sqlite3_bind_int64(stmt, 1, start);
     sqlite3_bind_int64(stmt, 2, end);
-
+    sqlite3_bind_int(stmt, 3, RANGE_LIMIT - (int)res.size());
     while (sqlite3_step(stmt) == SQLITE_ROW) {
       SampleData s = {};
       s.timestamp = sqlite3_column_int64(stmt, 0);
       s.theta = sqlite3_column_double(stmt, 1);
       res.push_back(s);
     }
-  }
-  sqlite3_finalize(stmt);
-  return res;
-}
+    releaseStatement(stmt);   // unpin + release the read lock
+  };
 
-SampleData DBManager::getLatestSampleForDevice(const String &deviceId) {
-  SampleData s = {};
-  sqlite3_stmt *stmt;
-  const char *sql =
-      "SELECT id, timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
-      "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, status, "
-      "urgency, confidence, qc_valid, seq, air_temp_c, humidity, "
-      "raw_adc_2, theta_2, device_id, battery_pct "
-      "FROM samples WHERE device_id = ? ORDER BY timestamp DESC LIMIT 1";
-
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-    sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
-    if (sqlite3_step(stmt) == SQLITE_ROW) {
-      s.id = sqlite3_column_int(stmt, 0);
-      s.timestamp = sqlite3_column_int64(stmt, 1);
-      s.raw_adc = sqlite3_column_int(stmt, 2);
-      s.temp_c = sqlite3_column_double(stmt, 3);
-      s.theta = sqlite3_column_double(stmt, 4);
-      s.theta_fc = sqlite3_column_double(stmt, 5);
-      s.theta_refill = sqlite3_column_double(stmt, 6);
-      s.psi_kpa = sqlite3_column_double(stmt, 7);
-      s.aw_mm = sqlite3_column_double(stmt, 8);
-      s.fraction_depleted = sqlite3_column_double(stmt, 9);
-      s.drying_rate = sqlite3_column_double(stmt, 10);
-      s.regime = String((const char *)sqlite3_column_text(stmt, 11));
-      s.status = String((const char *)sqlite3_column_text(stmt, 12));
-      s.urgency = String((const char *)sqlite3_column_text(stmt, 13));
-      s.confidence = sqlite3_column_double(stmt, 14);
-      s.qc_valid = sqlite3_column_int(stmt, 15) != 0;
-      s.seq = sqlite3_column_int(stmt, 16);
-      s.air_temp_c = sqlite3_column_double(stmt, 17);
-      s.humidity = sqlite3_column_double(stmt, 18);
-      s.raw_adc_2 = sqlite3_column_int(stmt, 19);
-      s.theta_2 = sqlite3_column_double(stmt, 20);
-      s.device_id = String((const char *)sqlite3_column_text(stmt, 21));
-      s.battery_pct = sqlite3_column_int(stmt, 22);
-    }
+  // Oldest-first: legacy table, then overlapping partitions ascending.
+  queryTable("samples");
+  for (int i = 0; i < partitionCount && (int)res.size() < RANGE_LIMIT; i++) {
+    // 3-day slop on the upper bound: the last week bucket of a year can run
+    // a couple of days past startTs + 7 days.
+    if (partitions[i].startTs > end ||
+        partitions[i].startTs + WEEK_SECONDS + 3 * 86400 < start)
+      continue;
+    queryTable(partitions[i].name);
   }
-  sqlite3_finalize(stmt);
-  return s;
-}
 
-std::vector<SampleData> DBManager::getRecentSamples(int n,
-                                                    const String &deviceId) {
-  std::vector<SampleData> res;
-  sqlite3_stmt *stmt;
-  const char *sql =
-      "SELECT id, timestamp, raw_adc, temp_c, theta, theta_fc, theta_refill, "
-      "psi_kpa, aw_mm, fraction_depleted, drying_rate, regime, status, "
-      "urgency, confidence, qc_valid, seq, air_temp_c, humidity, "
-      "raw_adc_2, theta_2, device_id, battery_pct "
-      "FROM samples WHERE device_id = ? ORDER BY timestamp DESC LIMIT ?";
-
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
-    sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(stmt, 2, n);
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-      SampleData s = {};
-      s.id = sqlite3_column_int(stmt, 0);
-      s.timestamp = sqlite3_column_int64(stmt, 1);
-      s.raw_adc = sqlite3_column_int(stmt, 2);
-      s.temp_c = sqlite3_column_double(stmt, 3);
-      s.theta = sqlite3_column_double(stmt, 4);
-      s.theta_fc = sqlite3_column_double(stmt, 5);
-      s.theta_refill = sqlite3_column_double(stmt, 6);
-      s.psi_kpa = sqlite3_column_double(stmt, 7);
-      s.aw_mm = sqlite3_column_double(stmt, 8);
-      s.fraction_depleted = sqlite3_column_double(stmt, 9);
-      s.drying_rate = sqlite3_column_double(stmt, 10);
-      s.regime = String((const char *)sqlite3_column_text(stmt, 11));
-      s.status = String((const char *)sqlite3_column_text(stmt, 12));
-      s.urgency = String((const char *)sqlite3_column_text(stmt, 13));
-      s.confidence = sqlite3_column_double(stmt, 14);
-      s.qc_valid = sqlite3_column_int(stmt, 15) != 0;
-      s.seq = sqlite3_column_int(stmt, 16);
-      s.air_temp_c = sqlite3_column_double(stmt, 17);
-      s.humidity = sqlite3_column_double(stmt, 18);
-      s.raw_adc_2 = sqlite3_column_int(stmt, 19);
-      s.theta_2 = sqlite3_column_double(stmt, 20);
-      s.device_id = String((const char *)sqlite3_column_text(stmt, 21));
-      s.battery_pct = sqlite3_column_int(stmt, 22);
-      res.push_back(s);
+  // The newest data lives in the segment log — merge overlapping segments
+  // last, ascending by id (i.e. by time).  The index narrows the walk to
+  // files whose range intersects [start, end].
+  if (segReady && (int)res.size() < RANGE_LIMIT) {
+    char paths[8][48];
+    int nseg = 0;
+    sqlite3_stmt *stmt = getStatement(
+        readDb(),
+        "SELECT file FROM segments WHERE end_ts >= ?1 AND start_ts <= ?2 "
+        "ORDER BY id ASC LIMIT 8");
+    if (stmt) {
+      sqlite3_bind_int64(stmt, 1, start);
+      sqlite3_bind_int64(stmt, 2, end);
+      while (nseg < 8 && sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *f = (const char *)sqlite3_column_text(stmt, 0);
+        if (f)
+          snprintf(paths[nseg++], sizeof(paths[0]), "%s", f);
+      }
+      releaseStatement(stmt);
+    }
+    std::vector<SampleData> blk(SegmentLog::BLOCK_MAX_ROWS);
+    SegmentLog::Reader reader;
+    for (int i = 0; i < nseg && (int)res.size() < RANGE_LIMIT; i++) {
+      if (!reader.open(paths[i]))
+        continue;
+      int got;
+      while ((got = reader.nextBlock(blk.data())) > 0 &&
+             (int)res.size() < RANGE_LIMIT) {
+        for (int k = 0; k < got && (int)res.size() < RANGE_LIMIT; k++) {
+          if (blk[k].timestamp < start || blk[k].timestamp > end)
+            continue;
+          SampleData s = {};
+          s.timestamp = blk[k].timestamp;
+          s.theta = blk[k].theta;
+          res.push_back(s);
+        }
+      }
     }
   }
-  sqlite3_finalize(stmt);
   return res;
 }
 
 time_t DBManager::getDeviceLastSeen(const String &deviceId) {
-  sqlite3_stmt *stmt;
-  const char *sql = "SELECT MAX(timestamp) FROM samples WHERE device_id = ?";
-  time_t result = 0;
-  if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+  // device_status row first: a single primary-key probe, maintained lazily
+  // by the hub loop so it is at most a minute behind the data tables.
+  {
+    sqlite3_stmt *stmt = getStatement(
+        readDb(), "SELECT last_seen FROM device_status WHERE mac = ?");
+    if (stmt) {
+      sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
+      time_t ts = 0;
+      if (sqlite3_step(stmt) == SQLITE_ROW)
+        ts = (time_t)sqlite3_column_int64(stmt, 0);
+      releaseStatement(stmt);
+      if (ts > 0)
+        return ts;
+    }
+  }
+  // Segment log next (newest data): the newest matching block header
+  // already carries the answer — t0 + tSpan is the block's last
+  // timestamp — so no payload is decoded.
+  if (segReady) {
+    char paths[SampleCursor::MAX_SEGMENTS][48];
+    int ns = listRecentSegments(paths, SampleCursor::MAX_SEGMENTS);
+    SegmentLog::Reader reader;
+    for (int i = 0; i < ns; i++) {
+      if (!reader.open(paths[i]))
+        continue;
+      uint32_t offs[SampleCursor::MAX_BLOCKS];
+      int nb = reader.scanBlocks(offs, SampleCursor::MAX_BLOCKS,
+                                 deviceId.c_str());
+      if (nb > 0) {
+        SegBlockHeader hdr;
+        if (reader.readHeaderAt(offs[nb - 1], hdr))
+          return (time_t)(hdr.t0 + hdr.tSpan);
+      }
+    }
+  }
+  // SQLite fallback: per-device MAX(timestamp) is an index-only descent of
+  // idx_*_dev.  Newest table first — the first table with any row for the
+  // device holds its most recent timestamp.
+  const char *tabs[SampleCursor::MAX_TABLES];
+  int cnt = queryTables(tabs, SampleCursor::MAX_TABLES);
+  for (int i = 0; i < cnt; i++) {
+    char sql[128];
+    snprintf(sql, sizeof(sql),
+             "SELECT MAX(timestamp) FROM %s WHERE device_id = ?", tabs[i]);
+    sqlite3_stmt *stmt = getStatement(readDb(), sql);
+    if (!stmt)
+      continue;
     sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
+    time_t result = 0;
     if (sqlite3_step(stmt) == SQLITE_ROW)
       result = (time_t)sqlite3_column_int64(stmt, 0);
+    releaseStatement(stmt);   // unpin + release the read lock
+    if (result > 0)
+      return result;
   }
-  sqlite3_finalize(stmt);
-  return result;
+  return 0;
 }
 
+
 bool DBManager::executeSQL(const char *sql) {
   char *errMsg = nullptr;
   int rc = sqlite3_exec(db, sql, nullptr, nullptr, &errMsg);
@@ -447,43 +1312,212 @@ bool DBManager::executeSQL(const char *sql) {
   return true;
 }
 
+// Latest calibration audit row as JSON; {} when none has been written yet.
 String DBManager::getCalibrationJSON() {
-  // Stub
-  return "{}";
+  sqlite3_stmt *stmt = getStatement(
+      readDb(),
+      "SELECT timestamp, state, theta_fc, theta_refill, n_events, "
+      "confidence, params_json FROM calibration "
+      "ORDER BY version DESC LIMIT 1");
+  if (!stmt)
+    return "{}";
+  String json = "{}";
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    const char *state = (const char *)sqlite3_column_text(stmt, 1);
+    const char *params = (const char *)sqlite3_column_text(stmt, 6);
+    char buf[256];
+    snprintf(buf, sizeof(buf),
+             "{\"timestamp\":%lld,\"state\":\"%s\",\"theta_fc\":%.4f,"
+             "\"theta_refill\":%.4f,\"n_events\":%d,\"confidence\":%.3f,"
+             "\"params\":%s}",
+             (long long)sqlite3_column_int64(stmt, 0), state ? state : "",
+             sqlite3_column_double(stmt, 2), sqlite3_column_double(stmt, 3),
+             sqlite3_column_int(stmt, 4), sqlite3_column_double(stmt, 5),
+             (params && params[0]) ? params : "{}");
+    json = buf;
+  }
+  releaseStatement(stmt);   // unpin + release the read lock
+  return json;
 }
 
+// Appends one calibration audit row.  The binary snapshot on SD is what
+// warm boot restores from; this table is the history of how the estimates
+// evolved (one row per state transition, so it stays small).
 bool DBManager::writeCalibration(String state, float fc, float refill,
                                  int n_events, float conf, String params_json) {
-  return true; // Stub
+  sqlite3_stmt *stmt = getStatement(
+      db,
+      "INSERT INTO calibration (timestamp, state, theta_fc, theta_refill, "
+      "n_events, confidence, params_json) VALUES (?, ?, ?, ?, ?, ?, ?)");
+  if (!stmt)
+    return false;
+  sqlite3_bind_int64(stmt, 1, time(nullptr));
+  sqlite3_bind_text(stmt, 2, state.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_double(stmt, 3, fc);
+  sqlite3_bind_double(stmt, 4, refill);
+  sqlite3_bind_int(stmt, 5, n_events);
+  sqlite3_bind_double(stmt, 6, conf);
+  sqlite3_bind_text(stmt, 7, params_json.c_str(), -1, SQLITE_TRANSIENT);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  if (!ok)
+    Serial.printf("[DB] Calibration insert error: %s\n", sqlite3_errmsg(db));
+  releaseStatement(stmt);
+  return ok;
+}
+
+// Upsert of the per-device status row.  Callers rate-limit (at most once a
+// minute per device — see persistDirtyLastSeen in main.ino), so this never
+// becomes a per-packet write.
+bool DBManager::writeDeviceStatus(const String &deviceId, time_t lastSeen,
+                                  int batteryPct) {
+  sqlite3_stmt *stmt = getStatement(
+      db, "INSERT OR REPLACE INTO device_status (mac, last_seen, "
+          "battery_pct) VALUES (?, ?, ?)");
+  if (!stmt)
+    return false;
+  sqlite3_bind_text(stmt, 1, deviceId.c_str(), -1, SQLITE_TRANSIENT);
+  sqlite3_bind_int64(stmt, 2, lastSeen);
+  sqlite3_bind_int(stmt, 3, batteryPct);
+  bool ok = sqlite3_step(stmt) == SQLITE_DONE;
+  if (!ok)
+    Serial.printf("[DB] device_status upsert error: %s\n", sqlite3_errmsg(db));
+  releaseStatement(stmt);
+  return ok;
 }
 
 bool DBManager::cleanOldData(int daysToKeep) {
     time_t cutoff = time(nullptr) - ((time_t)daysToKeep * 86400);
+
+    // Partitioned data: retention is DROP TABLE per expired week —
+    // milliseconds, no tombstones, no truncating checkpoint needed.  A
+    // partition is expired only when its whole range (start + 7 days, plus
+    // the year-end slop) is older than the cutoff.
+    bool dropped = false;
+    for (int i = 0; i < partitionCount;) {
+        if (partitions[i].startTs + WEEK_SECONDS + 3 * 86400 >= cutoff) {
+            i++;
+            continue;
+        }
+        char sql[64];
+        snprintf(sql, sizeof(sql), "DROP TABLE IF EXISTS %s",
+                 partitions[i].name);
+        if (!executeSQL(sql)) {
+            i++;
+            continue;
+        }
+        Serial.printf("[DB] Dropped expired partition %s\n",
+                      partitions[i].name);
+        // Dropped statements for this table die with it — flush the cache
+        // rather than tracking which entries referenced it.
+        finalizeStatements();
+        for (int j = i; j < partitionCount - 1; j++)
+            partitions[j] = partitions[j + 1];
+        partitionCount--;
+        lastPartitionIdx = -1;
+        dropped = true;
+    }
+
+    // Segment-log retention: a sealed segment whose whole range is older
+    // than the cutoff is one SD.remove() plus an index-row delete.  The
+    // active (unsealed) segment is never a candidate.
+    if (segReady) {
+        static const int MAX_EXPIRED = 8;
+        int ids[MAX_EXPIRED];
+        char paths[MAX_EXPIRED][48];
+        int nExp = 0;
+        sqlite3_stmt *stmt = getStatement(
+            db, "SELECT id, file FROM segments WHERE sealed = 1 AND end_ts < ? "
+                "ORDER BY id ASC LIMIT 8");
+        if (stmt) {
+            sqlite3_bind_int64(stmt, 1, cutoff);
+            while (nExp < MAX_EXPIRED && sqlite3_step(stmt) == SQLITE_ROW) {
+                ids[nExp] = sqlite3_column_int(stmt, 0);
+                const char *f = (const char *)sqlite3_column_text(stmt, 1);
+                snprintf(paths[nExp], sizeof(paths[0]), "%s", f ? f : "");
+                nExp++;
+            }
+            releaseStatement(stmt);
+        }
+        for (int i = 0; i < nExp; i++) {
+            if (paths[i][0])
+                SD.remove(paths[i]);
+            char delSql[64];
+            snprintf(delSql, sizeof(delSql),
+                     "DELETE FROM segments WHERE id = %d", ids[i]);
+            executeSQL(delSql);
+            Serial.printf("[DB] Dropped expired segment %s\n", paths[i]);
+        }
+    }
+
+    // Legacy pre-partitioning table still shrinks by DELETE until retention
+    // ages it out entirely.
     char sql[128];
-    snprintf(sql, sizeof(sql), "DELETE FROM samples WHERE timestamp < %ld", (long)cutoff);
+    snprintf(sql, sizeof(sql), "DELETE FROM samples WHERE timestamp < %ld",
+             (long)cutoff);
     if (!executeSQL(sql)) return false;
-    executeSQL("PRAGMA wal_checkpoint(TRUNCATE);");
+    if (dropped)
+        executeSQL("PRAGMA wal_checkpoint(PASSIVE);");
     return true;
 }
 
 int DBManager::deduplicateRows() {
     if (!db) return -1;
-    // Count duplicates first
-    const char *countSQL = "SELECT COUNT(*) FROM samples WHERE id NOT IN "
-                           "(SELECT MIN(id) FROM samples GROUP BY device_id, timestamp, seq)";
-    sqlite3_stmt *stmt;
-    int count = 0;
-    if (sqlite3_prepare_v2(db, countSQL, -1, &stmt, nullptr) == SQLITE_OK) {
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            count = sqlite3_column_int(stmt, 0);
+    // Repair tool only — ingest-side dedup (device registry seq window) and
+    // the per-table unique indexes keep duplicates out of new data, so this
+    // exists for databases written before either guard.  Each table is
+    // processed in bounded id-range chunks, each its own implicit
+    // transaction, so nothing is locked for more than one chunk and the
+    // ingest path keeps flowing.
+    static const sqlite3_int64 DEDUP_CHUNK = 2000;
+
+    const char *tabs[SampleCursor::MAX_TABLES];
+    int cnt = queryTables(tabs, SampleCursor::MAX_TABLES);
+
+    int total = 0;
+    for (int t = 0; t < cnt; t++) {
+        sqlite3_int64 minId = 0, maxId = 0;
+        {
+            char boundsSQL[80];
+            snprintf(boundsSQL, sizeof(boundsSQL),
+                     "SELECT MIN(id), MAX(id) FROM %s", tabs[t]);
+            sqlite3_stmt *stmt;
+            if (sqlite3_prepare_v2(db, boundsSQL, -1, &stmt, nullptr) !=
+                SQLITE_OK)
+                continue;
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                minId = sqlite3_column_int64(stmt, 0);
+                maxId = sqlite3_column_int64(stmt, 1);
+            }
+            sqlite3_finalize(stmt);
+        }
+        if (maxId == 0)
+            continue;
+
+        // The EXISTS probe walks the table's unique index, so each chunk
+        // touches only its own id range plus index lookups — no full-table
+        // GROUP BY pass.
+        char chunkSQL[320];
+        snprintf(chunkSQL, sizeof(chunkSQL),
+                 "DELETE FROM %s WHERE id BETWEEN ? AND ? AND EXISTS ("
+                 "SELECT 1 FROM %s s2 WHERE s2.device_id = %s.device_id "
+                 "AND s2.timestamp = %s.timestamp AND s2.seq = %s.seq "
+                 "AND s2.id < %s.id)",
+                 tabs[t], tabs[t], tabs[t], tabs[t], tabs[t], tabs[t]);
+
+        for (sqlite3_int64 lo = minId; lo <= maxId; lo += DEDUP_CHUNK) {
+            sqlite3_stmt *stmt = getStatement(db, chunkSQL);
+            if (!stmt)
+                break;
+            sqlite3_bind_int64(stmt, 1, lo);
+            sqlite3_bind_int64(stmt, 2, lo + DEDUP_CHUNK - 1);
+            if (sqlite3_step(stmt) == SQLITE_DONE)
+                total += sqlite3_changes(db);
+            releaseStatement(stmt);
+            // Yield between chunks so the writer task can commit in the gaps
+            vTaskDelay(pdMS_TO_TICKS(5));
         }
-        sqlite3_finalize(stmt);
     }
-    if (count == 0) return 0;
-
-    const char *deleteSQL = "DELETE FROM samples WHERE id NOT IN "
-                            "(SELECT MIN(id) FROM samples GROUP BY device_id, timestamp, seq)";
-    if (!executeSQL(deleteSQL)) return -1;
-    Serial.printf("[DB] Deduplicated: removed %d duplicate rows\n", count);
-    return count;
-}
\ No newline at end of file
+    if (total > 0)
+        Serial.printf("[DB] Deduplicated: removed %d duplicate rows\n", total);
+    return total;
+}
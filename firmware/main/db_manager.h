@@ -5,6 +5,8 @@
 #include <sqlite3.h>
 #include <vector>
 
+#include "segment_log.h"
+
 struct SampleData {
   int id; // AUTOINCREMENT primary key — do not set manually
   time_t timestamp;
@@ -21,14 +23,22 @@ struct SampleData {
   float aw_mm;
   float fraction_depleted;
   float drying_rate;
-  String regime;
-  String status;
-  String urgency;
+  // Fixed-size text fields — the String versions cost four heap allocations
+  // per sample, and heap fragmentation is what eventually kills long-uptime
+  // hubs.  Sizes match the SensorReading fields they are copied from.
+  char regime[16] = "";
+  char status[16] = "";
+  char urgency[8] = "";
   float confidence;
   bool qc_valid;
   int seq;
-  String device_id = "HUB_ONBOARD";
+  char device_id[18] = "HUB_ONBOARD";
   int battery_pct = -1;
+
+  void setRegime(const char *s) { snprintf(regime, sizeof(regime), "%s", s); }
+  void setStatus(const char *s) { snprintf(status, sizeof(status), "%s", s); }
+  void setUrgency(const char *s) { snprintf(urgency, sizeof(urgency), "%s", s); }
+  void setDeviceId(const char *s) { snprintf(device_id, sizeof(device_id), "%s", s); }
 };
 
 class DBManager {
@@ -39,14 +49,115 @@ public:
   // Lifecycle
   bool init();
 
+  // Asynchronous writer.  queueSample() is cheap and returns immediately;
+  // a background task swaps the fill/flush buffers by pointer and commits
+  // to SD off the ingest path (measured 80-400 ms per commit).
+  bool startWriter();
+  void queueSample(const SampleData &s);
+  void flushQueued();   // synchronous drain, e.g. before deep sleep
+
   // Core Operations
   bool writeSampleBatch(std::vector<SampleData> &samples);
+
+  // One pre-aggregated bucket from the hourly/daily rollup tables.
+  // Averages are computed from the stored sums at read time.
+  struct SeriesPoint {
+    time_t bucket;
+    int n;
+    float theta_min, theta_max, theta_avg, theta_last;
+    float temp_min, temp_max, temp_avg;
+    float psi_min, psi_max, psi_avg;
+  };
+  // Serves long ranges from the rollups maintained in writeSampleBatch.
+  // resolution_s: 3600 for hourly buckets, 86400 (or more) for daily.
+  std::vector<SeriesPoint> getSeriesAggregated(time_t start, time_t end,
+                                               int resolution_s,
+                                               const String &deviceId);
+  // Borrowed view of the current sqlite3 row.  The char* fields point into
+  // sqlite3's own row buffer and are valid only until the cursor advances —
+  // copy them if they must outlive the visit.  No heap allocation per row.
+  struct RowView {
+    int id;
+    time_t timestamp;
+    int raw_adc, raw_adc_2;
+    float temp_c, humidity, air_temp_c;
+    float theta, theta_2, theta_fc, theta_refill;
+    float psi_kpa, aw_mm, fraction_depleted, drying_rate;
+    const char *regime;
+    const char *status;
+    const char *urgency;
+    float confidence;
+    bool qc_valid;
+    int seq;
+    const char *device_id;
+    int battery_pct;
+  };
+
+  // Pull-style cursor over recent samples.  Obtain via openRecentSamples,
+  // call next() until it returns false, then close() (also runs from the
+  // destructor).  The cursor walks partitions newest-first, compiling a
+  // private statement per table so it can safely outlive the call site
+  // (e.g. across chunked-response callbacks).
+  class SampleCursor {
+  public:
+    SampleCursor() {}
+    ~SampleCursor() { close(); }
+    SampleCursor(const SampleCursor &) = delete;
+    SampleCursor &operator=(const SampleCursor &) = delete;
+    bool next(RowView &out);
+    void close();
+
+  private:
+    friend class DBManager;
+    sqlite3 *db = nullptr;
+    sqlite3_stmt *stmt = nullptr;
+    static const int MAX_TABLES = 8;
+    char tables[MAX_TABLES][20];   // newest partition first, legacy last
+    int tableCount = 0;
+    int tableIdx = 0;
+    char devId[18] = "";           // empty = all devices
+    int remaining = 0;
+    bool openNextTable();
+
+    // Segment-log stage — segments hold the newest data, so they are
+    // walked before the SQLite tables.  Blocks within a file and rows
+    // within a block are time-ascending, so both are emitted in reverse.
+    // Four segments ≈ 1 MB of raw samples, far deeper than any recent-
+    // samples limit; anything older falls through to the tables only if
+    // it predates the segment log.
+    static const int MAX_SEGMENTS = 4;
+    static const int MAX_BLOCKS = 128;
+    char segPaths[MAX_SEGMENTS][48];
+    int segCount = 0;
+    int segIdx = 0;
+    SegmentLog::Reader segReader;
+    uint32_t blockOffs[MAX_BLOCKS];
+    int blockIdx = -1;   // descending walk over blockOffs
+    SampleData rowBuf[SegmentLog::BLOCK_MAX_ROWS];
+    int rowIdx = -1;     // descending walk over the decoded block
+    bool nextSegmentRow(RowView &out);
+  };
+
+  // n newest samples, newest first; empty deviceId = all devices.
+  bool openRecentSamples(SampleCursor &cur, int n, const String &deviceId);
+
+  // Push-style wrapper over the cursor: invokes visit(row, ctx) per row,
+  // stops early if it returns false.  Returns rows visited.  Handlers can
+  // stream rows straight into a response with no intermediate vector.
+  typedef bool (*RowVisitor)(const RowView &row, void *ctx);
+  int forEachSample(int n, const String &deviceId, RowVisitor visit,
+                    void *ctx);
+
   SampleData getLatestSample();
   std::vector<SampleData> getRecentSamples(int n);
   std::vector<SampleData> getSamplesInRange(time_t start, time_t end);
   SampleData getLatestSampleForDevice(const String &deviceId);
   std::vector<SampleData> getRecentSamples(int n, const String &deviceId);
   time_t getDeviceLastSeen(const String &deviceId);
+  // Lazy upsert of the device_status row backing getDeviceLastSeen's fast
+  // path; rate-limited by the caller, not here.
+  bool writeDeviceStatus(const String &deviceId, time_t lastSeen,
+                         int batteryPct);
 
   // Calibration
   bool writeCalibration(String state, float fc, float refill, int n_events,
@@ -60,10 +171,94 @@ public:
 private:
   sqlite3 *db;
   const char *dbPath;
-  sqlite3_stmt *insertStmt;
+
+  // Boot tail shared by the schema-version fast path and the migration
+  // path: partition discovery, segment-log resume, read connection.
+  bool initConnections();
+
+  // Second, read-only connection for the query paths.  WAL supports one
+  // writer plus concurrent readers, but only across connections — on a
+  // single handle a read arriving mid-commit queues behind the
+  // transaction.  Routing every get* through dbRead lets the web
+  // handlers read the previous WAL snapshot while the writer task
+  // commits.  Falls back to the writer connection if the open fails.
+  sqlite3 *dbRead = nullptr;
+  sqlite3 *readDb() { return dbRead ? dbRead : db; }
+
+  // Time-partitioned storage: one samples_YYYYWW table per week bucket
+  // (WW = tm_yday/7, zero-padded).  Writes are routed to the bucket of the
+  // row's timestamp; reads walk the in-memory partition list; retention is
+  // DROP TABLE — milliseconds, no tombstones, no checkpoint storm.  The
+  // original `samples` table stays as a read-only legacy partition holding
+  // pre-partitioning data until retention ages it out.
+  static const int MAX_PARTITIONS = 26;
+  struct Partition {
+    int key;          // year*100 + week-of-year
+    time_t startTs;   // first second of the week bucket
+    char name[20];
+  };
+  Partition partitions[MAX_PARTITIONS];
+  int partitionCount = 0;
+  int lastPartitionIdx = -1;   // fast path: consecutive rows share a bucket
+  void loadPartitions();
+  const char *ensurePartition(time_t ts);
+  static int partitionKeyFor(time_t ts, time_t *startOut);
+  static time_t yearStartEpoch(int year);
+  // Fills tables[] newest-partition-first with the legacy table last;
+  // returns the count.
+  int queryTables(const char *out[], int maxOut);
+
+  // Double-buffered writer state: producers fill *fillBuf under a short
+  // mutex hold; the writer task swaps the pointers and flushes the other
+  // buffer without blocking ingest.
+  std::vector<SampleData> bufA, bufB;
+  std::vector<SampleData> *fillBuf = &bufA;
+  std::vector<SampleData> *flushBuf = &bufB;
+  SemaphoreHandle_t bufMutex = nullptr;
+  TaskHandle_t writerTask = nullptr;
+  static void writerTaskEntry(void *self);
+  void writerLoop();
+
+  // Prepared-statement cache.  Each query is compiled once (parse + plan is
+  // ~30% of read-path latency on the hub) and reset/rebound thereafter.
+  // Keyed by the connection plus an owned copy of the SQL text so callers
+  // may pass snprintf'd per-partition SQL from a stack buffer; stale
+  // partition entries are evicted round-robin once the cache fills.
+  static const int STMT_CACHE_SIZE = 32;
+  struct CachedStmt {
+    sqlite3 *conn;
+    char *sql;
+    sqlite3_stmt *stmt;
+    bool inUse;   // pinned between getStatement and releaseStatement
+  };
+  CachedStmt stmtCache[STMT_CACHE_SIZE] = {};
+  int stmtRecycleIdx = 0;
+  // Guards the cache bookkeeping — four tasks borrow statements (writer,
+  // web, loop, physics).  The bind/step work itself happens outside the
+  // lock on the borrowed, pinned statement.
+  SemaphoreHandle_t stmtMutex = nullptr;
+  sqlite3_stmt *getStatement(sqlite3 *conn, const char *sql);
+  void releaseStatement(sqlite3_stmt *stmt);
+  void finalizeStatements();
+
+  // Continuous aggregates: every inserted row also upserts into the hourly
+  // and daily rollup tables, inside the same transaction as the raw insert.
+  void rollupSample(const SampleData &s);
+  void upsertRollup(const char *sql, time_t bucket, const SampleData &s);
+
+  // Append-only segment log (see segment_log.h): raw samples go to
+  // sequential columnar appends on SD; SQLite keeps the rollups and a small
+  // `segments` index table mapping segment files to their time ranges.
+  // When the log is unavailable (SD error at init), writes fall back to the
+  // partitioned insert path below.
+  SegmentLog segLog;
+  bool segReady = false;
+  void insertSampleRow(const SampleData &s);
+  void updateSegmentIndex(time_t t0, time_t t1, int rows);
+  void sealActiveSegment();
+  int listRecentSegments(char paths[][48], int maxOut);
 
   bool executeSQL(const char *sql);
-  bool prepareStatements();
 };
 
 #endif
\ No newline at end of file
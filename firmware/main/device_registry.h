@@ -0,0 +1,153 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+
+#include <Arduino.h>
+#include <string.h>
+
+// =============================================================================
+// IN-MEMORY DEVICE REGISTRY
+// =============================================================================
+// Everything the ingest path and /api/devices need to know about a cropband
+// fits in a few hundred bytes of RAM, yet it used to live behind a
+// paired_devices.json read (SD) per packet and a SELECT MAX(timestamp) scan
+// (SQLite) per /api/devices hit.  This registry is an open-addressing hash
+// map keyed by the 6-byte MAC: linear probing, entries never removed, sized
+// well above the largest fleet we ship (12 nodes).  Unknown-device checks
+// and last-seen updates become O(1) with zero I/O; paired_devices.json stays
+// the persistent source of truth and is only touched when the pairing state
+// actually changes.
+
+struct DeviceEntry {
+    uint8_t  mac[6];
+    bool     used = false;
+    bool     paired = false;
+    bool     announced = false;      // already written to paired_devices.json
+    time_t   lastSeen = 0;
+    int8_t   batteryPct = -1;        // -1 = unknown
+    uint32_t seqHighWater = 0;
+    bool     lastSeenDirty = false;  // pending lazy persistence
+    uint32_t lastPersistMs = 0;      // millis() of last device_status upsert
+
+    // Recent (timestamp, seq) identities for ESP-NOW retransmit dedup.
+    // Written only from the receive callback (single writer), consulted
+    // before a reading is ever queued — see DeviceRegistry::isDuplicate.
+    static const int DEDUP_WINDOW = 8;
+    struct {
+        time_t   ts;
+        uint32_t seq;
+    }        recent[DEDUP_WINDOW];
+    uint8_t  recentHead = 0;
+    uint8_t  recentLen = 0;
+};
+
+class DeviceRegistry {
+public:
+    // Power of two for mask probing; ~2.5x the 12-node fleet keeps the load
+    // factor low enough that probes rarely go past the first slot.
+    static const int CAPACITY = 32;
+
+    DeviceEntry* find(const uint8_t mac[6]) {
+        uint32_t idx = hashMac(mac) & (CAPACITY - 1);
+        for (int probe = 0; probe < CAPACITY; probe++) {
+            DeviceEntry& e = _slots[(idx + probe) & (CAPACITY - 1)];
+            if (!e.used)
+                return nullptr;
+            if (memcmp(e.mac, mac, 6) == 0)
+                return &e;
+        }
+        return nullptr;
+    }
+
+    DeviceEntry* findOrAdd(const uint8_t mac[6]) {
+        uint32_t idx = hashMac(mac) & (CAPACITY - 1);
+        for (int probe = 0; probe < CAPACITY; probe++) {
+            DeviceEntry& e = _slots[(idx + probe) & (CAPACITY - 1)];
+            if (e.used) {
+                if (memcmp(e.mac, mac, 6) == 0)
+                    return &e;
+                continue;
+            }
+            memcpy(e.mac, mac, 6);
+            e.used = true;
+            _count++;
+            return &e;
+        }
+        return nullptr;   // table full — fleet far beyond design size
+    }
+
+    // Ingest-path update: O(1), zero I/O.  Returns the entry so the caller
+    // can check pairing state without a second lookup.
+    DeviceEntry* touch(const uint8_t mac[6], time_t ts, int8_t battery,
+                       uint32_t seq) {
+        DeviceEntry* e = findOrAdd(mac);
+        if (!e)
+            return nullptr;
+        if (ts > e->lastSeen) {
+            e->lastSeen = ts;
+            e->lastSeenDirty = true;
+        }
+        if (battery >= 0)
+            e->batteryPct = battery;
+        if (seq > e->seqHighWater)
+            e->seqHighWater = seq;
+        return e;
+    }
+
+    // Retransmit dedup: returns true if (ts, seq) was already seen in this
+    // device's recent window, otherwise records it and returns false.
+    // (0, 0) carries no identity (RTC-less cropband, no sequence counter)
+    // and is never treated as a duplicate.  Call only from the ESP-NOW
+    // receive task — the ring has a single writer by design.
+    bool isDuplicate(DeviceEntry* e, time_t ts, uint32_t seq) {
+        if (!e || (ts == 0 && seq == 0))
+            return false;
+        for (int i = 0; i < e->recentLen; i++) {
+            int idx = (e->recentHead - 1 - i + DeviceEntry::DEDUP_WINDOW) %
+                      DeviceEntry::DEDUP_WINDOW;
+            if (e->recent[idx].ts == ts && e->recent[idx].seq == seq)
+                return true;
+        }
+        e->recent[e->recentHead].ts = ts;
+        e->recent[e->recentHead].seq = seq;
+        e->recentHead = (e->recentHead + 1) % DeviceEntry::DEDUP_WINDOW;
+        if (e->recentLen < DeviceEntry::DEDUP_WINDOW)
+            e->recentLen++;
+        return false;
+    }
+
+    // Slot access for iteration — callers skip !used entries.
+    DeviceEntry* slot(int i) { return &_slots[i]; }
+    int size() const { return _count; }
+
+    static void formatMac(const uint8_t mac[6], char out[18]) {
+        snprintf(out, 18, "%02X:%02X:%02X:%02X:%02X:%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+
+    static bool parseMac(const char* str, uint8_t out[6]) {
+        unsigned int b[6];
+        if (sscanf(str, "%2x:%2x:%2x:%2x:%2x:%2x",
+                   &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6)
+            return false;
+        for (int i = 0; i < 6; i++)
+            out[i] = (uint8_t)b[i];
+        return true;
+    }
+
+private:
+    DeviceEntry _slots[CAPACITY];
+    int _count = 0;
+
+    // FNV-1a over the 6 MAC bytes — cheap and spreads the vendor-prefix
+    // similarity across the table.
+    static uint32_t hashMac(const uint8_t mac[6]) {
+        uint32_t h = 2166136261u;
+        for (int i = 0; i < 6; i++) {
+            h ^= mac[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+};
+
+#endif // DEVICE_REGISTRY_H
@@ -0,0 +1,142 @@
+#ifndef ENGINE_MANAGER_H
+#define ENGINE_MANAGER_H
+
+#include <Arduino.h>
+
+#include "physics_engine.h"
+
+// =============================================================================
+// PER-DEVICE PHYSICS ENGINES — BUDGETED HISTORY POOL
+// =============================================================================
+// One PhysicsEngine per reporting device (the hub's onboard sensor
+// included).  Engines themselves are small once the history arrays moved
+// out (see history_buffer.h); the rings are where the real memory goes,
+// so begin() divides a fixed RAM budget by the approved-device count and
+// every engine gets a ring of that depth.  One device enjoys the full
+// 30-day ring; a 12-node fleet gets shallower rings instead of an
+// allocation the ESP32 could never satisfy — full depth for the whole
+// fleet would be ~690 KB against a largest contiguous DRAM block of
+// ~110-160 KB.  Slices are malloc'd one per engine at adopt time, not as
+// one arena, for the same reason: many small blocks fit where one huge
+// one cannot.
+//
+// Single-threaded by design: findOrCreate runs only on the physics task,
+// the same discipline the deviceEngines map followed before it.
+
+class EngineManager {
+public:
+    static const int MAX_ENGINES = 16;
+
+    // Total RAM the history rings may take across the fleet.  Chosen to
+    // leave the web server, SQLite page cache and WiFi stack their usual
+    // headroom on a 320 KB-DRAM part.
+    static const size_t HISTORY_BUDGET_BYTES = 96 * 1024;
+
+    // Floor on ring depth: 288 points = 3 days at 15-min intervals, the
+    // depth the firmware shipped with before the pooled rings.  QC and
+    // autocalibration stay useful here; below it they starve.
+    static const int HISTORY_MIN_POINTS = 288;
+
+    // Sizes the per-engine rings for up to maxEngines devices (clamped to
+    // MAX_ENGINES).  Call once at boot, before any engine is created.
+    // Allocation itself is deferred to adopt(), so this cannot fail —
+    // the bool return is kept so callers assert the call order.
+    bool begin(int maxEngines) {
+        if (maxEngines < 1) maxEngines = 1;
+        if (maxEngines > MAX_ENGINES) maxEngines = MAX_ENGINES;
+        _max = maxEngines;
+        int points = (int)(HISTORY_BUDGET_BYTES / maxEngines /
+                           HistoryBuffer::bytesFor(1));
+        if (points > HISTORY_MAX) points = HISTORY_MAX;
+        if (points < HISTORY_MIN_POINTS) points = HISTORY_MIN_POINTS;
+        _points = points;
+        Serial.printf("[ENG] History pool: %d slot(s) x %d points (%u KB)\n",
+                      _max, _points,
+                      (unsigned)(_max * HistoryBuffer::bytesFor(_points) /
+                                 1024));
+        return true;
+    }
+
+    // Registers an externally owned engine (the Physics global) and binds
+    // it a freshly malloc'd history ring.  Returns false only when the
+    // pool is full.  If the heap cannot supply a ring even at the minimum
+    // depth the engine is still registered and runs degraded — live
+    // readings flow, but QC percentiles, autocalibration and rehydration
+    // see an empty history — and the failure is logged loudly rather
+    // than dropping the device.
+    bool adopt(const char* deviceId, PhysicsEngine* eng) {
+        if (_count >= _max) {
+            Serial.printf("[ENG] ERROR: pool full (%d) - cannot adopt %s\n",
+                          _max, deviceId);
+            return false;
+        }
+        int points = _points;
+        uint8_t* mem = (uint8_t*)malloc(HistoryBuffer::bytesFor(points));
+        while (!mem && points > HISTORY_MIN_POINTS) {
+            // Heap tighter than the boot-time estimate — halve and retry.
+            points /= 2;
+            if (points < HISTORY_MIN_POINTS) points = HISTORY_MIN_POINTS;
+            mem = (uint8_t*)malloc(HistoryBuffer::bytesFor(points));
+        }
+        Slot& s = _slots[_count++];
+        snprintf(s.id, sizeof(s.id), "%s", deviceId);
+        s.eng = eng;
+        if (!mem) {
+            Serial.printf("[ENG] ERROR: no heap for %s history (%u B) - "
+                          "running without history\n",
+                          deviceId,
+                          (unsigned)HistoryBuffer::bytesFor(
+                              HISTORY_MIN_POINTS));
+            return true;
+        }
+        if (points < _points)
+            Serial.printf("[ENG] WARN: %s history reduced to %d points\n",
+                          deviceId, points);
+        eng->bindHistoryStorage(mem, points);
+        return true;
+    }
+
+    PhysicsEngine* find(const char* deviceId) {
+        for (int i = 0; i < _count; i++)
+            if (strcmp(_slots[i].id, deviceId) == 0)
+                return _slots[i].eng;
+        return nullptr;
+    }
+
+    // Find-or-create; sets *created so the caller can run one-time
+    // configuration (crop/soil, calibration restore, rehydration).
+    // Returns nullptr when the pool is exhausted.
+    PhysicsEngine* findOrCreate(const char* deviceId, bool* created) {
+        *created = false;
+        PhysicsEngine* eng = find(deviceId);
+        if (eng)
+            return eng;
+        if (_count >= _max) {
+            Serial.printf("[ENG] Pool full (%d) - dropping %s\n", _max,
+                          deviceId);
+            return nullptr;
+        }
+        eng = new PhysicsEngine();
+        adopt(deviceId, eng);   // cannot fail: pool checked above
+        *created = true;
+        return eng;
+    }
+
+    int count() const { return _count; }
+    const char* idAt(int i) const { return _slots[i].id; }
+    PhysicsEngine* at(int i) { return _slots[i].eng; }
+    int historyPoints() const { return _points; }
+
+private:
+    struct Slot {
+        char id[18];
+        PhysicsEngine* eng;
+    };
+
+    Slot _slots[MAX_ENGINES] = {};
+    int _count = 0;
+    int _max = 0;
+    int _points = HISTORY_MIN_POINTS;   // ring depth set by begin()
+};
+
+#endif // ENGINE_MANAGER_H
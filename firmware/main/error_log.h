@@ -0,0 +1,128 @@
+#ifndef ERROR_LOG_H
+#define ERROR_LOG_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+
+// =============================================================================
+// SENSOR ERROR LOG — LOCK-FREE MPSC RING
+// =============================================================================
+// logSensorError used to open/append/close /logs/sensor_errors.csv inline
+// on the sensor path, so one misbehaving sensor tripping QC every sample
+// turned logging itself into an SD-latency bottleneck.  Producers (the
+// sensor loop, the physics task, the ESP-NOW callback) now enqueue a
+// fixed-size record here; a low-priority drain task batches the SD
+// appends and collapses runs of the same flag into one row with a repeat
+// count.  A small RAM tail of the most recent records lets the log API
+// answer without touching the card.
+//
+// Multi-producer / single-consumer: unlike ingest_queue.h (one producer),
+// several tasks log errors, so each slot carries a sequence number that
+// arbitrates producers (Vyukov bounded queue).  The drain task is the
+// only consumer.
+
+struct ErrorRecord {
+    time_t   timestamp;
+    float    value;
+    uint16_t repeats;   // extra occurrences folded in by dedup (0 = single)
+    char     flag[18];
+};
+
+class ErrorLog {
+public:
+    // Power of two so the index wrap is a mask.  64 records absorbs a
+    // full drain interval of a sensor failing on every sample.
+    static const uint32_t CAPACITY  = 64;
+    static const int      TAIL_SIZE = 32;   // records kept in RAM for the API
+
+    ErrorLog() : _head(0), _dropped(0), _tailSeq(0) {
+        for (uint32_t i = 0; i < CAPACITY; i++)
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Producer side — safe from any task, never blocks.  Returns false
+    // and counts a drop when the drain task is a full ring behind.
+    bool push(const char* flag, float value) {
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        Slot* s;
+        for (;;) {
+            s = &_slots[pos & (CAPACITY - 1)];
+            uint32_t seq = s->seq.load(std::memory_order_acquire);
+            int32_t  dif = (int32_t)(seq - pos);
+            if (dif == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+        s->rec.timestamp = time(nullptr);
+        s->rec.value     = value;
+        s->rec.repeats   = 0;
+        snprintf(s->rec.flag, sizeof(s->rec.flag), "%s", flag);
+        s->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side (drain task only).
+    bool pop(ErrorRecord& out) {
+        Slot& s = _slots[_tailPos & (CAPACITY - 1)];
+        uint32_t seq = s.seq.load(std::memory_order_acquire);
+        if ((int32_t)(seq - (_tailPos + 1)) < 0)
+            return false;   // slot not committed yet
+        out = s.rec;
+        s.seq.store(_tailPos + CAPACITY, std::memory_order_release);
+        _tailPos++;
+        return true;
+    }
+
+    // Drain task records what it popped so the API can show it.
+    void rememberTail(const ErrorRecord& r) {
+        uint32_t seq = _tailSeq.load(std::memory_order_relaxed);
+        _tailRing[seq % TAIL_SIZE] = r;
+        _tailSeq.store(seq + 1, std::memory_order_release);
+    }
+
+    // Newest-first CSV of the RAM tail.  Read unlocked: the drain task
+    // can overwrite the oldest entry mid-read, which at worst tears one
+    // row of a diagnostics dump — same trade ingest_queue.h makes.
+    size_t tailCsv(char* out, size_t cap) {
+        out[0] = '\0';
+        uint32_t seq = _tailSeq.load(std::memory_order_acquire);
+        uint32_t n   = seq < (uint32_t)TAIL_SIZE ? seq : (uint32_t)TAIL_SIZE;
+        size_t used = 0;
+        for (uint32_t i = 0; i < n && used + 48 < cap; i++) {
+            const ErrorRecord& r = _tailRing[(seq - 1 - i) % TAIL_SIZE];
+            used += snprintf(out + used, cap - used, "%lu,%s,%.2f,%u\n",
+                             (unsigned long)r.timestamp, r.flag, r.value,
+                             (unsigned)r.repeats);
+        }
+        return used;
+    }
+
+    uint32_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        ErrorRecord           rec;
+    };
+
+    Slot                  _slots[CAPACITY];
+    std::atomic<uint32_t> _head;      // producers (CAS)
+    uint32_t              _tailPos = 0;  // drain task only
+    std::atomic<uint32_t> _dropped;
+
+    ErrorRecord           _tailRing[TAIL_SIZE];
+    std::atomic<uint32_t> _tailSeq;   // total records remembered
+};
+
+#endif // ERROR_LOG_H
@@ -0,0 +1,165 @@
+#ifndef HISTORY_BUFFER_H
+#define HISTORY_BUFFER_H
+
+#include <Arduino.h>
+#include <string.h>
+
+// =============================================================================
+// SENSOR HISTORY — STRUCTURE-OF-ARRAYS RING BUFFER
+// =============================================================================
+
+// History buffer ceiling - 2880 = 30 days at 15-min intervals (matches the
+// JS version).  This is the deepest ring any engine may bind, not what each
+// one gets: at 15 B/point a full-depth ring is ~43 KB, and a classic ESP32
+// cannot give that to every node in a 12-node fleet, so the actual
+// per-device capacity is picked at bind time (see engine_manager.h).  The
+// old array-of-structs layout cost 24 B/point and a full memmove on every
+// push once full; the SoA ring below pushes in O(1) and lets the stats
+// kernels stride dense float arrays instead of interleaved struct fields.
+#define HISTORY_MAX 2880
+#define FC_HISTORY_MAX 16
+
+struct DataPoint {
+    time_t  timestamp;
+    int     raw;
+    float   temp_c;
+    float   theta;
+    bool    qc_valid;
+};
+
+// Circular structure-of-arrays store for the sample history.
+// Logical index 0 is the oldest retained point, len()-1 the newest; the
+// mapping to physical slots is internal.  Each field lives in its own dense
+// array so per-field scans (std-dev, percentile, regression) stay cache-
+// friendly on the ESP32.
+//
+// Storage is externally owned: every engine used to embed its own ~43 KB
+// of arrays, which made a second PhysicsEngine instance cost a second
+// 43 KB whether or not its device ever reported.  The arrays now live in
+// a heap slice handed over via bindStorage() (see engine_manager.h),
+// sized per fleet at boot — capacity is a bind-time argument, not a
+// compile-time constant, so twelve nodes can share RAM that one node
+// would spend on a deeper ring.  An unbound buffer is a valid empty
+// ring: push() drops points and len() stays 0.
+class HistoryBuffer {
+public:
+    // Bytes a ring of `points` capacity needs, ordered by alignment below.
+    static constexpr size_t bytesFor(int points) {
+        return (size_t)points * (sizeof(time_t) + 2 * sizeof(float) +
+                                 sizeof(int16_t) + sizeof(bool));
+    }
+    // Full-depth size (== bytesFor(HISTORY_MAX), spelled out because a
+    // constexpr member can't be called before the class is complete),
+    // kept for callers that bind a static arena (the host replay
+    // harness).
+    static const size_t STORAGE_BYTES =
+        (size_t)HISTORY_MAX * (sizeof(time_t) + 2 * sizeof(float) +
+                               sizeof(int16_t) + sizeof(bool));
+
+    HistoryBuffer() { clear(); }
+
+    // Carves the field arrays out of `base` (at least bytesFor(points),
+    // aligned for time_t) and resets the ring.
+    void bindStorage(uint8_t* base, int points = HISTORY_MAX) {
+        if (points < 1) points = 1;
+        _cap = points;
+        _timestamp = (time_t*)base;          base += (size_t)points * sizeof(time_t);
+        _temp      = (float*)base;           base += (size_t)points * sizeof(float);
+        _theta     = (float*)base;           base += (size_t)points * sizeof(float);
+        _raw       = (int16_t*)base;         base += (size_t)points * sizeof(int16_t);
+        _qc        = (bool*)base;
+        clear();
+    }
+    bool bound() const { return _timestamp != nullptr; }
+
+    void clear() { _head = 0; _len = 0; }
+    int  len() const { return _len; }
+    int  capacity() const { return _cap; }
+
+    // O(1) append; overwrites the oldest point once the ring is full.
+    void push(const DataPoint& p) {
+        if (!_timestamp) return;
+        int slot;
+        if (_len < _cap) {
+            slot = phys(_len);
+            _len++;
+        } else {
+            slot = _head;
+            _head = (_head + 1 == _cap) ? 0 : _head + 1;
+        }
+        _timestamp[slot] = p.timestamp;
+        _raw[slot]       = (int16_t)p.raw;   // ADC is 12-bit, -1 = absent
+        _temp[slot]      = p.temp_c;
+        _theta[slot]     = p.theta;
+        _qc[slot]        = p.qc_valid;
+    }
+
+    // Warm-boot rehydration: inserts before the current oldest point, so
+    // feeding points newest-first (the order DB cursors yield them) leaves
+    // the logical order time-ascending.  Returns false once the ring is
+    // full.
+    bool pushOlder(const DataPoint& p) {
+        if (!_timestamp || _len >= _cap) return false;
+        _head = (_head == 0) ? _cap - 1 : _head - 1;
+        _len++;
+        _timestamp[_head] = p.timestamp;
+        _raw[_head]       = (int16_t)p.raw;
+        _temp[_head]      = p.temp_c;
+        _theta[_head]     = p.theta;
+        _qc[_head]        = p.qc_valid;
+        return true;
+    }
+
+    // Per-field accessors by logical index (0 = oldest).
+    time_t timestamp(int i) const { return _timestamp[phys(i)]; }
+    int    raw(int i)       const { return _raw[phys(i)]; }
+    float  temp(int i)      const { return _temp[phys(i)]; }
+    float  theta(int i)     const { return _theta[phys(i)]; }
+    bool   qcValid(int i)   const { return _qc[phys(i)]; }
+
+    DataPoint point(int i) const {
+        int p = phys(i);
+        return { _timestamp[p], (int)_raw[p], _temp[p], _theta[p], _qc[p] };
+    }
+
+    // Copies n theta values starting at logical index `from` into dst.
+    // At most two memcpys regardless of wrap position.
+    void copyTheta(int from, int n, float* dst) const {
+        int p     = phys(from);
+        int first = _cap - p;
+        if (first > n) first = n;
+        memcpy(dst, _theta + p, first * sizeof(float));
+        if (n > first)
+            memcpy(dst + first, _theta, (n - first) * sizeof(float));
+    }
+
+    // Logical index of the first point with timestamp >= t (history is
+    // time-ordered).  Returns len() if every point is older than t.
+    int firstIndexAtOrAfter(time_t t) const {
+        for (int i = _len - 1; i >= 0; i--) {
+            if (timestamp(i) < t) return i + 1;
+        }
+        return 0;
+    }
+
+private:
+    int phys(int i) const {
+        int idx = _head + i;
+        if (idx >= _cap) idx -= _cap;
+        return idx;
+    }
+
+    // Externally owned field arrays (_cap elements each, see
+    // bindStorage); null until bound.
+    time_t*  _timestamp = nullptr;
+    int16_t* _raw = nullptr;
+    float*   _temp = nullptr;
+    float*   _theta = nullptr;
+    bool*    _qc = nullptr;
+
+    int _cap = HISTORY_MAX;   // ring capacity, set at bind time
+    int _head;   // physical slot of the oldest point
+    int _len;
+};
+
+#endif // HISTORY_BUFFER_H
@@ -0,0 +1,79 @@
+#ifndef INGEST_QUEUE_H
+#define INGEST_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+// =============================================================================
+// ESP-NOW → PHYSICS INGEST QUEUE
+// =============================================================================
+// Single-producer / single-consumer lock-free ring.  The ESP-NOW receive
+// callback (producer, WiFi task) does nothing but validate and enqueue a
+// RawReading; the physics task (consumer, pinned to the other core) drains
+// the queue and runs calibration/QC/DB staging.  No locks, no allocation,
+// so a burst from 12 cropbands never blocks the radio or the web server.
+
+// One raw reading as received off the air — everything the physics task
+// needs, nothing heap-allocated.
+struct RawReading {
+    uint8_t  mac[6];
+    uint16_t raw_adc;      // 0xFFFF = no soil sensor
+    uint16_t raw_adc_2;    // 0xFFFF = no second channel (all v1 frames)
+    float    temp_c;
+    float    humidity;
+    float    air_temp_c;
+    int8_t   battery_pct;  // -1 = unknown
+    uint32_t seq;
+    time_t   timestamp;
+};
+
+class IngestQueue {
+public:
+    // Power of two so the index wrap is a mask, sized for a full burst from
+    // 12 nodes plus retransmits.
+    static const uint32_t CAPACITY = 64;
+
+    IngestQueue() : _head(0), _tail(0), _dropped(0) {}
+
+    // Producer side (ESP-NOW callback).  Returns false and counts a drop if
+    // the consumer has fallen a full ring behind.
+    bool push(const RawReading& r) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= CAPACITY) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _ring[head & (CAPACITY - 1)] = r;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side (physics task).
+    bool pop(RawReading& out) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t head = _head.load(std::memory_order_acquire);
+        if (tail == head) return false;
+        out = _ring[tail & (CAPACITY - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t pending() const {
+        return _head.load(std::memory_order_acquire) -
+               _tail.load(std::memory_order_acquire);
+    }
+
+    uint32_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    RawReading            _ring[CAPACITY];
+    std::atomic<uint32_t> _head;     // written by producer only
+    std::atomic<uint32_t> _tail;     // written by consumer only
+    std::atomic<uint32_t> _dropped;
+};
+
+#endif // INGEST_QUEUE_H
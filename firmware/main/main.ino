@@ -7,8 +7,15 @@
  * 4. Web Server API
  */
 
+#include "crop_tables.h"  // generated — see tools/gen_crop_tables.py
 #include "db_manager.h"
+#include "device_registry.h"
+#include "engine_manager.h"
+#include "error_log.h"
+#include "ingest_queue.h"
+#include "perf_timer.h"
 #include "physics_engine.h"
+#include "sensor_frame.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <DHT.h>
@@ -18,7 +25,7 @@
 #include <SD.h>
 #include <WiFi.h>
 #include <esp_now.h>  // Issue 7: ESP-NOW for CropBand pairing
-#include <map>        // Issue 7: per-device physics instances
+#include <memory>     // shared_ptr for chunked-response stream contexts
 
 // =============================================================================
 // PIN DEFINITIONS
@@ -42,11 +49,13 @@ OneWire oneWire(TEMP_PIN);
 DallasTemperature tempSensor(&oneWire);
 DHT dht(DHT_PIN, DHT22);
 
-std::vector<SampleData> sampleBuffer;
-const int BATCH_SIZE = 6;
 
 static uint32_t seqTimestamp = 1000000;
 
+// Calibration snapshots are persisted at most this often per device
+static unsigned long lastCalSaveMillis = 0;
+const unsigned long CAL_SAVE_INTERVAL_MS = 10UL * 60UL * 1000UL;
+
 // Cache of latest physics output — read by /api/current without DB round-trip
 static SensorReading lastReading = {};
 static SampleData lastCachedSample = {};
@@ -56,20 +65,26 @@ static float lastHumidity = -1.0f;
 // Sensor 2 calibration instance (ADC → VWC conversion only, independent sensor)
 static SensorCalibration sensor2Cal;
 
-// Issue 7: ESP-NOW CropBand packet format
-typedef struct __attribute__((packed)) {
-  uint8_t version;      // must be 1
-  uint16_t raw_adc;     // soil moisture ADC 0-4095, or 0xFFFF if sensor absent
-  float temp_c;         // DS18B20 temp in Celsius, or -1.0 if unavailable
-  float humidity;       // DHT22 humidity %, or -1.0 if unavailable
-  float air_temp_c;     // DHT22 air temp in Celsius, or -1.0 if unavailable
-  uint8_t battery_pct;  // 0-100, or 255 if unknown
-  uint32_t timestamp;   // Unix timestamp or 0 if no RTC
-  uint8_t crc8;         // CRC8 over all preceding bytes
-} CropBandPacket;
-
-// Issue 7: per-device physics instances
-std::map<String, PhysicsEngine *> deviceEngines;
+// Issue 7: ESP-NOW CropBand wire format lives in sensor_frame.h — one
+// header shared with the cropband sketch, versioned by the first byte.
+
+// Issue 7/24: per-device physics instances, history pooled in one arena
+EngineManager engineManager;
+
+// ESP-NOW → physics pipeline (see ingest_queue.h).  The receive callback
+// only enqueues; the physics task pinned to core 0 does all the real work,
+// keeping AsyncWebServer (core 1) responsive during packet bursts.
+IngestQueue ingestQueue;
+TaskHandle_t physicsTaskHandle = nullptr;
+
+// Sensor-error log ring (see error_log.h).  Producers enqueue from any
+// task; errorLogDrainTask owns /logs/sensor_errors.csv.
+ErrorLog errorLog;
+
+// RAM mirror of device state (pairing, last-seen, battery, seq high-water).
+// Seeded from paired_devices.json at boot; paired_devices.json is only
+// rewritten when pairing state changes.  See device_registry.h.
+DeviceRegistry deviceRegistry;
 
 // =============================================================================
 // CROP CONFIG
@@ -114,59 +129,74 @@ bool loadThresholds() {
     prefsFile.close();
   }
 
-  File threshFile = SD.open("/config/crop_thresholds.json", FILE_READ);
-  if (!threshFile) {
-    Serial.println("[THRESH] crop_thresholds.json not found - using defaults");
-    return false;
+  // Resolve the crop/soil pair from the generated constexpr tables
+  // (crop_tables.h) — no SD read, no JSON DOM.  Unknown keys fall back
+  // to the same tomato/loam defaults the parser used.
+  int ci = findCropIndex(activeCrop.crop_key.c_str());
+  if (ci < 0) {
+    Serial.printf("[THRESH] Unknown crop '%s' - using tomato\n",
+                  activeCrop.crop_key.c_str());
+    ci = findCropIndex("tomato");
   }
-
-  DynamicJsonDocument filter(1024);
-  filter["crops"][activeCrop.crop_key] = true;
-  filter["soils"][activeCrop.soil_key] = true;
-
-  DynamicJsonDocument doc(12288);
-  DeserializationError err =
-    deserializeJson(doc, threshFile, DeserializationOption::Filter(filter));
-  threshFile.close();
-
-  if (err) {
-    Serial.printf("[THRESH] Parse error: %s\n", err.c_str());
+  int si = findSoilIndex(activeCrop.soil_key.c_str());
+  if (si < 0)
+    si = findSoilIndex("loam");
+  if (ci < 0 || si < 0) {
+    Serial.println("[THRESH] Table lookup failed");
     return false;
   }
 
-  JsonObject soil = doc["soils"][activeCrop.soil_key];
-  if (soil.isNull())
-    soil = doc["soils"]["loam"];
-  if (soil.isNull()) {
-    Serial.println("[THRESH] No soil profile found");
-    return false;
-  }
-
-  JsonArray stages =
-    doc["crops"][activeCrop.crop_key]["stages"].as<JsonArray>();
-  if (stages.isNull())
-    stages = doc["crops"]["tomato"]["stages"].as<JsonArray>();
-  if (stages.isNull() || stages.size() == 0) {
-    Serial.println("[THRESH] No stage data found");
-    return false;
-  }
-
-  activeCrop.theta_fc = soil["theta_fc"] | 0.31f;
-  activeCrop.theta_wp = soil["theta_wp"] | 0.14f;
-
-  JsonObject activeStage = stages[stages.size() - 1];
-  for (JsonObject stage : stages) {
-    int ds = stage["day_start"] | 0;
-    int de = stage["day_end"] | 0;
-    if (activeCrop.days_after_planting >= ds && activeCrop.days_after_planting <= de) {
-      activeStage = stage;
-      break;
+  activeCrop.theta_fc = SOIL_TABLE[si].theta_fc;
+  activeCrop.theta_wp = SOIL_TABLE[si].theta_wp;
+  const CropStageRow &st =
+    cropStageFor(CROP_TABLE[ci], activeCrop.days_after_planting);
+  activeCrop.p = st.p;
+  activeCrop.Zr_cm = st.Zr_cm;
+  activeCrop.stage_name = st.name;
+
+  // crop_thresholds.json on SD is now an override layer only: when a
+  // field-tuned copy is present, its values for the active pair win over
+  // the baked tables.  Absence or a parse error is not an error.
+  File threshFile = SD.open("/config/crop_thresholds.json", FILE_READ);
+  if (threshFile) {
+    DynamicJsonDocument filter(1024);
+    filter["crops"][activeCrop.crop_key] = true;
+    filter["soils"][activeCrop.soil_key] = true;
+
+    DynamicJsonDocument doc(12288);
+    DeserializationError err =
+      deserializeJson(doc, threshFile, DeserializationOption::Filter(filter));
+    threshFile.close();
+
+    if (err) {
+      Serial.printf("[THRESH] Override parse error: %s (ignored)\n",
+                    err.c_str());
+    } else {
+      JsonObject soil = doc["soils"][activeCrop.soil_key];
+      if (!soil.isNull()) {
+        activeCrop.theta_fc = soil["theta_fc"] | activeCrop.theta_fc;
+        activeCrop.theta_wp = soil["theta_wp"] | activeCrop.theta_wp;
+      }
+      JsonArray stages =
+        doc["crops"][activeCrop.crop_key]["stages"].as<JsonArray>();
+      if (!stages.isNull() && stages.size() > 0) {
+        JsonObject activeStage = stages[stages.size() - 1];
+        for (JsonObject stage : stages) {
+          int ds = stage["day_start"] | 0;
+          int de = stage["day_end"] | 0;
+          if (activeCrop.days_after_planting >= ds &&
+              activeCrop.days_after_planting <= de) {
+            activeStage = stage;
+            break;
+          }
+        }
+        activeCrop.p = activeStage["p"] | activeCrop.p;
+        activeCrop.Zr_cm = activeStage["Zr_cm"] | activeCrop.Zr_cm;
+        activeCrop.stage_name = activeStage["name"] | activeCrop.stage_name;
+      }
     }
   }
 
-  activeCrop.p = activeStage["p"] | 0.5f;
-  activeCrop.Zr_cm = activeStage["Zr_cm"] | 30.0f;
-  activeCrop.stage_name = activeStage["name"] | "early";
   activeCrop.theta_refill =
     activeCrop.theta_fc - activeCrop.p * (activeCrop.theta_fc - activeCrop.theta_wp);
   activeCrop.loaded = true;
@@ -183,13 +213,64 @@ bool loadThresholds() {
 // ISSUE 11: ADC SENSOR VALIDATION
 // =============================================================================
 
+// Enqueue only — never touches the card on the sensor path.  The drain
+// task below batches the SD appends.
 void logSensorError(const char *flag, float value) {
-  if (!SD.exists("/logs"))
-    SD.mkdir("/logs");
-  File f = SD.open("/logs/sensor_errors.csv", FILE_APPEND);
-  if (f) {
-    f.printf("%lu,%s,%.2f\n", (unsigned long)time(nullptr), flag, value);
-    f.close();
+  errorLog.push(flag, value);
+}
+
+// Low-priority consumer of the error ring.  Wakes every couple of
+// seconds, collapses runs of the same flag within a 30 s window into one
+// row with a repeat count, and writes the whole batch in a single
+// open/append/close — one SD touch per cycle no matter how noisy a
+// sensor gets.
+void errorLogDrainTask(void *arg) {
+  static const time_t DEDUP_WINDOW_S = 30;
+  static char lines[1536];
+  ErrorRecord held = {};
+  bool haveHeld = false;
+
+  auto formatLine = [&](size_t used, const ErrorRecord &r) -> size_t {
+    if (used + 48 >= sizeof(lines))
+      return used;  // batch full — remainder goes out next cycle
+    return used + snprintf(lines + used, sizeof(lines) - used,
+                           "%lu,%s,%.2f,%u\n", (unsigned long)r.timestamp,
+                           r.flag, r.value, (unsigned)r.repeats);
+  };
+
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(2000));
+
+    size_t used = 0;
+    ErrorRecord r;
+    while (errorLog.pop(r)) {
+      errorLog.rememberTail(r);
+      if (haveHeld && strcmp(held.flag, r.flag) == 0 &&
+          r.timestamp - held.timestamp < DEDUP_WINDOW_S) {
+        held.repeats++;
+        held.value = r.value;  // latest reading wins
+        continue;
+      }
+      if (haveHeld)
+        used = formatLine(used, held);
+      held = r;
+      haveHeld = true;
+    }
+    // Flush the held record once its dedup window has passed
+    if (haveHeld && time(nullptr) - held.timestamp >= DEDUP_WINDOW_S) {
+      used = formatLine(used, held);
+      haveHeld = false;
+    }
+
+    if (used > 0) {
+      if (!SD.exists("/logs"))
+        SD.mkdir("/logs");
+      File f = SD.open("/logs/sensor_errors.csv", FILE_APPEND);
+      if (f) {
+        f.write((const uint8_t *)lines, used);
+        f.close();
+      }
+    }
   }
 }
 
@@ -211,43 +292,77 @@ bool validateSensorReading(int raw_adc, float temp_c) {
 // ISSUE 2: CALIBRATION PERSISTENCE
 // =============================================================================
 
-void saveCalibration(const String &deviceMac) {
+static PhysicsEngine *engineFor(const String &deviceMac) {
+  return engineManager.find(deviceMac.c_str());
+}
+
+static const char *calStateName(int state) {
+  static const char *names[] = { "INIT", "BASELINE_MONITORING",
+                                 "WETTING_EVENT", "DRAINAGE_TRACKING",
+                                 "FC_ESTIMATE", "DRYDOWN_FIT",
+                                 "NORMAL_OPERATION" };
+  return (state >= 0 && state < 7) ? names[state] : "UNKNOWN";
+}
+
+// Writes the fixed-layout CalibrationSnapshot in a single SD write —
+// no serializer, no heap, ~130 bytes.  logTransition adds an audit row
+// to the calibration table; the periodic backstop save skips it so the
+// table only records state changes.
+void saveCalibration(const String &deviceMac, bool logTransition) {
   if (!SD.exists("/calibration"))
     SD.mkdir("/calibration");
-  String path = "/calibration/" + deviceMac + ".json";
 
-  PhysicsEngine *eng = nullptr;
-  if (deviceMac == "HUB_ONBOARD") {
-    eng = &Physics;
-  } else {
-    auto it = deviceEngines.find(deviceMac);
-    if (it != deviceEngines.end())
-      eng = it->second;
-  }
+  PhysicsEngine *eng = engineFor(deviceMac);
   if (!eng)
     return;
 
-  // Serialize calibration state via ArduinoJson
-  DynamicJsonDocument doc(1024);
-  doc["version"] = 1;
-  JsonObject cal = doc.createNestedObject("autoCalibration");
-  auto calState = eng->getCalibrationState();
-  cal["theta_fc_star"] = calState.theta_fc_star;
-  cal["theta_refill_star"] = calState.theta_refill_star;
-  cal["n_events"] = calState.n_events;
-  cal["n_fc_updates"] = calState.n_fc_updates;
-  cal["confidence"] = calState.confidence;
-  cal["state"] = (int)calState.state;
+  CalibrationSnapshot snap;
+  eng->getCalibrationSnapshot(snap);
 
+  String path = "/calibration/" + deviceMac + ".bin";
   File f = SD.open(path, FILE_WRITE);
   if (f) {
-    serializeJson(doc, f);
+    f.write((const uint8_t *)&snap, sizeof(snap));
     f.close();
     Serial.printf("[CAL] Saved calibration for %s\n", deviceMac.c_str());
   }
+
+  if (logTransition) {
+    char params[96];
+    snprintf(params, sizeof(params),
+             "{\"kd\":%.4f,\"ku\":%.5f,\"beta\":%.3f,\"theta_min\":%.3f}",
+             snap.kd, snap.ku, snap.beta, snap.theta_min);
+    dbManager.writeCalibration(calStateName(snap.state), snap.theta_fc_star,
+                               snap.theta_refill_star, snap.n_events,
+                               snap.confidence, params);
+  }
 }
 
 void loadCalibration(const String &deviceMac) {
+  PhysicsEngine *eng = engineFor(deviceMac);
+  if (!eng)
+    return;
+
+  // Binary snapshot (current format) — one read, one memcpy-shaped restore.
+  String binPath = "/calibration/" + deviceMac + ".bin";
+  if (SD.exists(binPath)) {
+    File f = SD.open(binPath, FILE_READ);
+    if (f) {
+      CalibrationSnapshot snap;
+      size_t got = f.read((uint8_t *)&snap, sizeof(snap));
+      f.close();
+      if (got == sizeof(snap) && snap.magic == CAL_SNAPSHOT_MAGIC &&
+          snap.version == CAL_SNAPSHOT_VERSION) {
+        eng->restoreCalibrationSnapshot(snap);
+        Serial.printf("[CAL] Restored calibration for %s (state %s)\n",
+                      deviceMac.c_str(), calStateName(snap.state));
+        return;
+      }
+    }
+  }
+
+  // Legacy JSON fallback — hubs upgraded in the field still have the old
+  // file; the next save replaces it with the binary format.
   String path = "/calibration/" + deviceMac + ".json";
   if (!SD.exists(path))
     return;
@@ -266,17 +381,6 @@ void loadCalibration(const String &deviceMac) {
   if (doc["version"] != 1)
     return;
 
-  PhysicsEngine *eng = nullptr;
-  if (deviceMac == "HUB_ONBOARD") {
-    eng = &Physics;
-  } else {
-    auto it = deviceEngines.find(deviceMac);
-    if (it != deviceEngines.end())
-      eng = it->second;
-  }
-  if (!eng)
-    return;
-
   JsonObject cal = doc["autoCalibration"];
   if (!cal.isNull()) {
     eng->restoreCalibrationState(
@@ -291,38 +395,35 @@ void loadCalibration(const String &deviceMac) {
   }
 }
 
-// =============================================================================
-// ISSUE 7: ESP-NOW CROPBAND PAIRING
-// =============================================================================
-
-uint8_t calcCRC8(const uint8_t *data, size_t len) {
-  uint8_t crc = 0xFF;
-  for (size_t i = 0; i < len; i++) {
-    crc ^= data[i];
-    for (int b = 0; b < 8; b++) {
-      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1);
-    }
-  }
-  return crc;
-}
-
-bool isPairedDevice(const String &mac) {
-  File f = SD.open("/config/paired_devices.json", FILE_READ);
-  if (!f)
-    return false;
-  DynamicJsonDocument doc(4096);
-  if (deserializeJson(doc, f)) {
-    f.close();
-    return false;
+// Warm-boot history rehydration: streams the last ring-capacity's worth of
+// stored points for the device back into the engine's history ring, so
+// drying-rate, regime and percentile outputs are valid from the first live
+// sample instead of hours into the uptime.  The cursor yields rows
+// newest-first, which is exactly the order pushOlder wants.
+void rehydrateHistory(PhysicsEngine *eng, const String &deviceId) {
+  DBManager::SampleCursor cur;
+  if (!dbManager.openRecentSamples(cur, eng->getHistory().capacity(),
+                                   deviceId))
+    return;
+  DBManager::RowView r;
+  int n = 0;
+  while (cur.next(r)) {
+    DataPoint p = { r.timestamp, r.raw_adc, r.temp_c, r.theta, r.qc_valid };
+    if (!eng->rehydrateHistoryPoint(p))
+      break;
+    n++;
   }
-  f.close();
-  for (JsonObject dev : doc["devices"].as<JsonArray>()) {
-    if (dev["mac"] == mac && dev["paired"] == true)
-      return true;
+  if (n > 0) {
+    eng->finishRehydration();
+    Serial.printf("[CAL] Rehydrated %d history points for %s\n", n,
+                  deviceId.c_str());
   }
-  return false;
 }
 
+// =============================================================================
+// ISSUE 7: ESP-NOW CROPBAND PAIRING
+// =============================================================================
+
 void registerUnknownDevice(const String &mac) {
   // Load existing list
   DynamicJsonDocument doc(4096);
@@ -352,75 +453,300 @@ void registerUnknownDevice(const String &mac) {
   Serial.printf("[ESPNOW] New device seen: %s\n", mac.c_str());
 }
 
-SensorReading runPhysicsForDevice(int raw_adc, float temp_c, time_t ts,
-                                  const String &deviceId) {
-  if (deviceEngines.find(deviceId) == deviceEngines.end()) {
-    deviceEngines[deviceId] = new PhysicsEngine();
+// Seeds the in-RAM device registry from paired_devices.json once at boot.
+// Last-seen is seeded from the DB here (one query per configured device,
+// once per boot) so /api/devices never needs SQLite at request time.
+void loadDeviceRegistry() {
+  File f = SD.open("/config/paired_devices.json", FILE_READ);
+  if (!f)
+    return;
+  DynamicJsonDocument doc(4096);
+  if (deserializeJson(doc, f)) {
+    f.close();
+    return;
+  }
+  f.close();
+  for (JsonObject dev : doc["devices"].as<JsonArray>()) {
+    const char *macStr = dev["mac"] | "";
+    uint8_t mac[6];
+    if (!DeviceRegistry::parseMac(macStr, mac))
+      continue;
+    DeviceEntry *e = deviceRegistry.findOrAdd(mac);
+    if (!e)
+      continue;
+    e->paired = dev["paired"] | false;
+    e->announced = true;
+    e->lastSeen = dbManager.getDeviceLastSeen(String(macStr));
+    e->lastSeenDirty = false;
+  }
+  Serial.printf("[REG] Loaded %d device(s) into registry\n",
+                deviceRegistry.size());
+}
+
+// Find-or-create the device engine: fresh engines get the active
+// crop/soil configuration, their saved calibration snapshot and a
+// rehydrated history ring before the first reading runs through them.
+// Returns nullptr when the engine pool is exhausted.
+PhysicsEngine *acquireEngineForDevice(const String &deviceId) {
+  bool created = false;
+  PhysicsEngine *eng = engineManager.findOrCreate(deviceId.c_str(), &created);
+  if (eng && created) {
     if (activeCrop.loaded) {
-      deviceEngines[deviceId]->configureCropSoil(
+      eng->configureCropSoil(
         activeCrop.crop_key.c_str(), activeCrop.soil_key.c_str(),
         activeCrop.p, activeCrop.theta_fc, activeCrop.theta_wp,
         activeCrop.theta_refill,
         (long)(time(nullptr) - activeCrop.days_after_planting * 86400L));
     }
+    loadCalibration(deviceId);
+    rehydrateHistory(eng, deviceId);
+  }
+  return eng;
+}
+
+SensorReading runPhysicsForDevice(int raw_adc, float temp_c, time_t ts,
+                                  const String &deviceId) {
+  PhysicsEngine *eng = acquireEngineForDevice(deviceId);
+  if (!eng) {
+    // Pool exhausted - already logged by the manager; surface an invalid
+    // reading so the sample is stored with qc_valid=false.
+    SensorReading none = {};
+    none.timestamp = ts;
+    none.raw_adc = raw_adc;
+    none.temp_c = temp_c;
+    return none;
   }
-  PhysicsEngine *eng = deviceEngines[deviceId];
   SensorReading reading = eng->processSensorReading(raw_adc, temp_c, ts);
   Serial.printf("[ESPNOW] Device %s theta=%.3f status=%s\n", deviceId.c_str(),
                 reading.theta, reading.status);
-  if (millis() - lastCalSaveMillis > CAL_SAVE_INTERVAL_MS) {
-      saveCalibration(deviceId);
+  // Snapshot immediately on calibration state transitions; the interval
+  // save is only a backstop for parameter drift between transitions.
+  if (eng->calibrationDirty()) {
+      saveCalibration(deviceId, true);
+      lastCalSaveMillis = millis();
+  } else if (millis() - lastCalSaveMillis > CAL_SAVE_INTERVAL_MS) {
+      saveCalibration(deviceId, false);
       lastCalSaveMillis = millis();
   }
   return reading;
 }
 
+// ESP-NOW receive callback — runs on the WiFi task.  Length/CRC gate,
+// then an in-place cast of the receive buffer (see sensor_frame.h): no
+// per-field parsing, no String construction, no allocation.  The one copy
+// left is the RawReading slotting into the ingest ring, which has to
+// happen anyway — the radio reclaims its buffer when this returns.
 void onEspNowReceive(const esp_now_recv_info *recv_info, const uint8_t *data,
                      int len) {
-  if (len < (int)sizeof(CropBandPacket))
+  uint8_t version = sensorFrameValidate(data, len);
+  if (version == 0)
     return;
 
-  CropBandPacket pkt;
-  memcpy(&pkt, data, sizeof(pkt));
+  RawReading r;
+  memcpy(r.mac, recv_info->src_addr, 6);
+  if (version == SENSOR_FRAME_V2) {
+    const SensorFrameV2 *f = (const SensorFrameV2 *)data;
+    r.raw_adc     = f->raw_adc;
+    r.raw_adc_2   = f->raw_adc_2;
+    r.temp_c      = f->temp_c;
+    r.humidity    = f->humidity;
+    r.air_temp_c  = f->air_temp_c;
+    r.battery_pct = (f->battery_pct == 255) ? -1 : (int8_t)f->battery_pct;
+    r.seq         = f->seq;
+    r.timestamp   = (time_t)f->timestamp;
+  } else {
+    const SensorFrameV1 *f = (const SensorFrameV1 *)data;
+    r.raw_adc     = f->raw_adc;
+    r.raw_adc_2   = 0xFFFF;   // v1 carries no second channel
+    r.temp_c      = f->temp_c;
+    r.humidity    = f->humidity;
+    r.air_temp_c  = f->air_temp_c;
+    r.battery_pct = (f->battery_pct == 255) ? -1 : (int8_t)f->battery_pct;
+    r.seq         = 0;        // v1 carries no sequence counter
+    r.timestamp   = (time_t)f->timestamp;
+  }
 
-  // Validate CRC (over all bytes except last)
-  uint8_t expected = calcCRC8(data, sizeof(pkt) - 1);
-  if (pkt.crc8 != expected) {
-    Serial.println("[ESPNOW] CRC mismatch — packet dropped");
+  // Drop ESP-NOW retransmits here so duplicates never reach the queue or
+  // the database.  find() only — slot creation stays on the physics task.
+  DeviceEntry *dev = deviceRegistry.find(r.mac);
+  if (dev && deviceRegistry.isDuplicate(dev, r.timestamp, r.seq))
     return;
+
+  ingestQueue.push(r);
+}
+
+// Full processing for one dequeued reading — runs on the physics task only.
+// =============================================================================
+// CURRENT-STATE SNAPSHOT CACHE
+// =============================================================================
+// /api/current used to run a SQLite query (device path) or ~25 String
+// concatenations (hub path) on every poll, with three dashboards polling at
+// 2 s intervals.  Instead, each processed reading is serialized ONCE into a
+// per-device double buffer and published with an atomic index swap; the
+// handler just copies the live buffer out.  Each slot has a single writer
+// (hub slot: sensor loop, device slots: physics task), so only the readers
+// need the atomic.  Buffers are allocated once at registration — no churn.
+
+static const int MAX_SNAPSHOTS = 13;             // 12 cropbands + hub onboard
+static const size_t SNAPSHOT_JSON_MAX = 1024;
+
+struct DeviceSnapshot {
+  char devId[18];
+  char *buf[2] = {nullptr, nullptr};
+  std::atomic<int> live{-1};                     // -1 = nothing published yet
+};
+static DeviceSnapshot currentSnaps[MAX_SNAPSHOTS];
+static std::atomic<int> currentSnapCount{0};
+static SemaphoreHandle_t snapRegisterMutex = nullptr;   // registration only
+
+static DeviceSnapshot *findSnapshot(const char *devId) {
+  int n = currentSnapCount.load(std::memory_order_acquire);
+  for (int i = 0; i < n; i++)
+    if (strcmp(currentSnaps[i].devId, devId) == 0)
+      return &currentSnaps[i];
+  return nullptr;
+}
+
+static void publishCurrentSnapshot(const char *devId, const char *json) {
+  DeviceSnapshot *s = findSnapshot(devId);
+  if (!s) {
+    // First reading from this device — register a slot.  Rare path, so a
+    // mutex is fine; lookups above stay lock-free.
+    if (!snapRegisterMutex)
+      return;
+    xSemaphoreTake(snapRegisterMutex, portMAX_DELAY);
+    s = findSnapshot(devId);
+    if (!s) {
+      int n = currentSnapCount.load(std::memory_order_relaxed);
+      if (n >= MAX_SNAPSHOTS) {
+        xSemaphoreGive(snapRegisterMutex);
+        return;
+      }
+      s = &currentSnaps[n];
+      snprintf(s->devId, sizeof(s->devId), "%s", devId);
+      s->buf[0] = (char *)malloc(SNAPSHOT_JSON_MAX);
+      s->buf[1] = (char *)malloc(SNAPSHOT_JSON_MAX);
+      if (!s->buf[0] || !s->buf[1]) {
+        xSemaphoreGive(snapRegisterMutex);
+        return;
+      }
+      currentSnapCount.store(n + 1, std::memory_order_release);
+    }
+    xSemaphoreGive(snapRegisterMutex);
   }
-  if (pkt.version != 1)
-    return;
+  int next = (s->live.load(std::memory_order_relaxed) == 0) ? 1 : 0;
+  snprintf(s->buf[next], SNAPSHOT_JSON_MAX, "%s", json);
+  s->live.store(next, std::memory_order_release);
+}
 
-  // Build MAC string
-  char macStr[18];
-  snprintf(macStr, sizeof(macStr), "%02X:%02X:%02X:%02X:%02X:%02X",
-           recv_info->src_addr[0], recv_info->src_addr[1],
-           recv_info->src_addr[2], recv_info->src_addr[3],
-           recv_info->src_addr[4], recv_info->src_addr[5]);
-  String macString(macStr);
+// -----------------------------------------------------------------------------
+// /api/devices snapshot — the whole response is serialized here once per
+// refresh interval and published with the same single-writer double-buffer
+// trick as currentSnaps, so the handler sends a pre-built string: no String
+// concatenation, no registry walk, no engine lookups per dashboard poll.
+// Refreshed from loop(); the same pass lazily persists dirty last-seen
+// values so a reboot starts within a minute of the truth.
+
+static const size_t DEVICES_JSON_MAX = 2048;
+static char devicesJson[2][DEVICES_JSON_MAX] = {"[]", "[]"};
+static std::atomic<int> devicesJsonLive{0};
+
+static void refreshDevicesSnapshot() {
+  int next = devicesJsonLive.load(std::memory_order_relaxed) ^ 1;
+  char *out = devicesJson[next];
+  size_t used = 0;
+  out[used++] = '[';
+  bool first = true;
+  for (int i = 0; i < DeviceRegistry::CAPACITY; i++) {
+    DeviceEntry *e = deviceRegistry.slot(i);
+    if (!e->used)
+      continue;
+    char mac[18];
+    DeviceRegistry::formatMac(e->mac, mac);
+    bool online = (engineManager.find(mac) != nullptr);
+    if (used + 112 >= DEVICES_JSON_MAX)
+      break;   // full fleet fits in ~100 bytes/device; never hit in practice
+    used += snprintf(out + used, DEVICES_JSON_MAX - used,
+                     "%s{\"mac\":\"%s\",\"paired\":%s,\"online\":%s,"
+                     "\"last_seen\":%ld,\"battery_pct\":%d}",
+                     first ? "" : ",", mac, e->paired ? "true" : "false",
+                     online ? "true" : "false", (long)e->lastSeen,
+                     (int)e->batteryPct);
+    first = false;
+  }
+  snprintf(out + used, DEVICES_JSON_MAX - used, "]");
+  devicesJsonLive.store(next, std::memory_order_release);
+}
 
-  if (!isPairedDevice(macString)) {
-    registerUnknownDevice(macString);
-    return;  // ignore data from unpaired devices
+// Background last-seen persistence: at most one device_status upsert per
+// device per minute, no matter how fast packets arrive.  touch() only sets
+// the dirty flag; the SQLite write happens here, off the ingest path.
+static void persistDirtyLastSeen() {
+  for (int i = 0; i < DeviceRegistry::CAPACITY; i++) {
+    DeviceEntry *e = deviceRegistry.slot(i);
+    if (!e->used || !e->lastSeenDirty)
+      continue;
+    if (e->lastPersistMs != 0 && millis() - e->lastPersistMs < 60000)
+      continue;
+    char mac[18];
+    DeviceRegistry::formatMac(e->mac, mac);
+    if (dbManager.writeDeviceStatus(String(mac), e->lastSeen,
+                                    e->batteryPct)) {
+      e->lastSeenDirty = false;
+      e->lastPersistMs = millis();
+    }
   }
+}
 
-  time_t ts = (time_t)pkt.timestamp;
+// Serializes a cropband sample in the /api/current?device= response format.
+static void buildDeviceCurrentJSON(const SampleData &s, char *out, size_t n) {
+  snprintf(out, n,
+           "{\"timestamp\":%ld,\"raw_adc\":%d,\"raw_adc_2\":%d,"
+           "\"temp_c\":%.1f,\"soil_temp_c\":%.1f,\"air_temp_c\":%.1f,"
+           "\"humidity\":%.1f,\"theta\":%.4f,\"theta_2\":%.4f,"
+           "\"psi_kpa\":%.2f,\"aw_mm\":%.1f,\"fractionDepleted\":%.3f,"
+           "\"dryingRate_per_hr\":%.4f,\"regime\":\"%s\",\"status\":\"%s\","
+           "\"urgency\":\"%s\",\"qc_valid\":%s,\"confidence\":%.2f,"
+           "\"battery_pct\":%d}",
+           (long)s.timestamp, s.raw_adc, s.raw_adc_2, s.temp_c, s.temp_c,
+           s.air_temp_c, s.humidity, s.theta, s.theta_2, s.psi_kpa, s.aw_mm,
+           s.fraction_depleted, s.drying_rate, s.regime, s.status, s.urgency,
+           s.qc_valid ? "true" : "false", s.confidence, s.battery_pct);
+}
+
+void processRawReading(const RawReading &r) {
+  char macStr[18];
+  DeviceRegistry::formatMac(r.mac, macStr);
+  String macString(macStr);
+
+  time_t ts = r.timestamp;
   if (ts < 1000000)
     ts = time(nullptr);
 
-  int battPct = (pkt.battery_pct == 255) ? -1 : (int)pkt.battery_pct;
+  // O(1) registry update replaces the per-packet paired_devices.json read.
+  DeviceEntry *dev = deviceRegistry.touch(r.mac, ts, r.battery_pct, r.seq);
+  if (!dev)
+    return;   // registry full — cannot happen at design fleet size
+  if (!dev->paired) {
+    if (!dev->announced) {
+      registerUnknownDevice(macString);   // one-time SD write per new MAC
+      dev->announced = true;
+    }
+    return;  // ignore data from unpaired devices
+  }
 
-  if (pkt.raw_adc == 0xFFFF) {
+  int battPct = r.battery_pct;
+
+  if (r.raw_adc == 0xFFFF) {
     // No soil sensor — write a metadata-only row
     SampleData s;
-    s.device_id = macString;
+    s.setDeviceId(macStr);
     s.battery_pct = battPct;
     s.timestamp = ts;
     s.raw_adc = -1;
-    s.temp_c = pkt.temp_c;
-    s.humidity = pkt.humidity;
-    s.air_temp_c = pkt.air_temp_c;
+    s.temp_c = r.temp_c;
+    s.humidity = r.humidity;
+    s.air_temp_c = r.air_temp_c;
     s.theta = -1;
     s.theta_fc = -1;
     s.theta_refill = -1;
@@ -428,26 +754,28 @@ void onEspNowReceive(const esp_now_recv_info *recv_info, const uint8_t *data,
     s.aw_mm = -1;
     s.fraction_depleted = -1;
     s.drying_rate = -1;
-    s.regime = "unknown";
-    s.status = "no_soil";
-    s.urgency = "none";
+    s.setRegime("unknown");
+    s.setStatus("no_soil");
+    s.setUrgency("none");
     s.confidence = 0;
     s.qc_valid = false;
-    s.seq = 0;
+    s.seq = (int)r.seq;
     s.theta_2 = -1;
     s.raw_adc_2 = -1;
-    std::vector<SampleData> batch = { s };
-    dbManager.writeSampleBatch(batch);
+    dbManager.queueSample(s);
+    char snap[SNAPSHOT_JSON_MAX];
+    buildDeviceCurrentJSON(s, snap, sizeof(snap));
+    publishCurrentSnapshot(macStr, snap);
   } else {
-    SensorReading reading = runPhysicsForDevice(pkt.raw_adc, pkt.temp_c, ts, macString);
+    SensorReading reading = runPhysicsForDevice(r.raw_adc, r.temp_c, ts, macString);
     SampleData s;
-    s.device_id = macString;
+    s.setDeviceId(macStr);
     s.battery_pct = battPct;
     s.timestamp = ts;
-    s.raw_adc = pkt.raw_adc;
-    s.temp_c = pkt.temp_c;
-    s.humidity = pkt.humidity;
-    s.air_temp_c = pkt.air_temp_c;
+    s.raw_adc = r.raw_adc;
+    s.temp_c = r.temp_c;
+    s.humidity = r.humidity;
+    s.air_temp_c = r.air_temp_c;
     s.theta = reading.theta;
     s.theta_fc = reading.theta_fc;
     s.theta_refill = reading.theta_refill;
@@ -455,29 +783,301 @@ void onEspNowReceive(const esp_now_recv_info *recv_info, const uint8_t *data,
     s.aw_mm = reading.AW_mm;
     s.fraction_depleted = reading.fractionDepleted;
     s.drying_rate = reading.dryingRate_per_hr;
-    s.regime = String(reading.regime);
-    s.status = String(reading.status);
-    s.urgency = String(reading.urgency);
+    s.setRegime(reading.regime);
+    s.setStatus(reading.status);
+    s.setUrgency(reading.urgency);
     s.confidence = reading.confidence;
     s.qc_valid = reading.qc_valid;
-    s.seq = 0;
-    s.theta_2 = -1;
-    s.raw_adc_2 = -1;
-    std::vector<SampleData> batch = { s };
-    dbManager.writeSampleBatch(batch);
+    s.seq = (int)r.seq;
+    // v2 frames carry a second soil channel; same factory-curve
+    // conversion the hub applies to its own sensor 2.
+    if (r.raw_adc_2 != 0xFFFF) {
+      s.raw_adc_2 = r.raw_adc_2;
+      s.theta_2 = sensor2Cal.calibrate(r.raw_adc_2, r.temp_c);
+    } else {
+      s.raw_adc_2 = -1;
+      s.theta_2 = -1;
+    }
+    dbManager.queueSample(s);
+    char snap[SNAPSHOT_JSON_MAX];
+    buildDeviceCurrentJSON(s, snap, sizeof(snap));
+    publishCurrentSnapshot(macStr, snap);
+  }
+}
+
+// Backlog drain (see PhysicsEngine::processSensorBatch): groups queued
+// readings per device and runs the batch kernel, so a burst or a
+// post-stall backlog pays for calibration/QC/history per row but for the
+// metrics stage only once per device.  Every row is still stored;
+// intermediate rows carry theta/qc_valid with metrics left at the -1
+// sentinel (status "backlog") since only the newest point's metrics feed
+// the snapshot and alerts.
+static const int DRAIN_MAX = 32;
+
+void drainBacklog(RawReading *rows, int n) {
+  bool used[DRAIN_MAX] = {};
+  static PhysicsEngine::BatchPoint pts[DRAIN_MAX];  // physics task only
+  static int idx[DRAIN_MAX];
+
+  for (int i = 0; i < n; i++) {
+    if (used[i])
+      continue;
+    if (rows[i].raw_adc == 0xFFFF) {
+      // Metadata-only rows keep the single-row path
+      processRawReading(rows[i]);
+      used[i] = true;
+      continue;
+    }
+
+    char macStr[18];
+    DeviceRegistry::formatMac(rows[i].mac, macStr);
+
+    // Gather this device's run, preserving arrival (time) order
+    int m = 0;
+    for (int j = i; j < n; j++) {
+      if (used[j] || rows[j].raw_adc == 0xFFFF)
+        continue;
+      if (memcmp(rows[j].mac, rows[i].mac, 6) != 0)
+        continue;
+      idx[m++] = j;
+      used[j] = true;
+    }
+
+    bool paired = true;
+    for (int k = 0; k < m; k++) {
+      const RawReading &r = rows[idx[k]];
+      time_t ts = r.timestamp;
+      if (ts < 1000000)
+        ts = time(nullptr);
+      DeviceEntry *dev = deviceRegistry.touch(r.mac, ts, r.battery_pct, r.seq);
+      if (!dev) {
+        paired = false;
+        break;
+      }
+      if (!dev->paired) {
+        if (!dev->announced) {
+          registerUnknownDevice(String(macStr));
+          dev->announced = true;
+        }
+        paired = false;
+        break;
+      }
+      pts[k].timestamp = ts;
+      pts[k].raw = r.raw_adc;
+      pts[k].temp_c = r.temp_c;
+    }
+    if (!paired)
+      continue;
+
+    PhysicsEngine *eng = acquireEngineForDevice(String(macStr));
+    if (!eng)
+      continue;
+    SensorReading reading = eng->processSensorBatch(pts, m);
+    if (eng->calibrationDirty()) {
+      saveCalibration(String(macStr), true);
+      lastCalSaveMillis = millis();
+    }
+
+    for (int k = 0; k < m; k++) {
+      const RawReading &r = rows[idx[k]];
+      bool newest = (k == m - 1);
+      SampleData s;
+      s.setDeviceId(macStr);
+      s.battery_pct = r.battery_pct;
+      s.timestamp = pts[k].timestamp;
+      s.raw_adc = pts[k].raw;
+      s.temp_c = r.temp_c;
+      s.humidity = r.humidity;
+      s.air_temp_c = r.air_temp_c;
+      s.theta = pts[k].theta;
+      s.qc_valid = pts[k].qc_valid;
+      s.theta_fc = reading.theta_fc;
+      s.theta_refill = reading.theta_refill;
+      s.seq = (int)r.seq;
+      if (r.raw_adc_2 != 0xFFFF) {
+        s.raw_adc_2 = r.raw_adc_2;
+        s.theta_2 = sensor2Cal.calibrate(r.raw_adc_2, r.temp_c);
+      } else {
+        s.raw_adc_2 = -1;
+        s.theta_2 = -1;
+      }
+      if (newest) {
+        s.psi_kpa = reading.psi_kPa;
+        s.aw_mm = reading.AW_mm;
+        s.fraction_depleted = reading.fractionDepleted;
+        s.drying_rate = reading.dryingRate_per_hr;
+        s.setRegime(reading.regime);
+        s.setStatus(reading.status);
+        s.setUrgency(reading.urgency);
+        s.confidence = reading.confidence;
+      } else {
+        s.psi_kpa = -1;
+        s.aw_mm = -1;
+        s.fraction_depleted = -1;
+        s.drying_rate = -1;
+        s.setRegime("unknown");
+        s.setStatus("backlog");
+        s.setUrgency("none");
+        s.confidence = 0;
+      }
+      dbManager.queueSample(s);
+      if (newest) {
+        char snap[SNAPSHOT_JSON_MAX];
+        buildDeviceCurrentJSON(s, snap, sizeof(snap));
+        publishCurrentSnapshot(macStr, snap);
+      }
+    }
+  }
+}
+
+// Physics task — pinned to core 0 (Arduino loop + AsyncWebServer run on
+// core 1).  Drains the ingest queue and does all calibration/QC/DB work
+// that used to run inside the receive callback.  A single queued reading
+// (the steady state) takes the per-sample path; anything more is a
+// backlog and goes through the batch kernel.
+void physicsTask(void *arg) {
+  static RawReading buf[DRAIN_MAX];
+  for (;;) {
+    int n = 0;
+    while (n < DRAIN_MAX && ingestQueue.pop(buf[n]))
+      n++;
+    if (n == 0) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    } else if (n == 1) {
+      processRawReading(buf[0]);
+    } else {
+      drainBacklog(buf, n);
+    }
   }
 }
 
 void initEspNow() {
   esp_now_init();
   esp_now_register_recv_cb(onEspNowReceive);
-  Serial.println("[ESPNOW] Receiver initialized");
+  xTaskCreatePinnedToCore(physicsTask, "physics", 8192, nullptr,
+                          2 /* above idle, below WiFi */, &physicsTaskHandle,
+                          0 /* core 0 */);
+  Serial.println("[ESPNOW] Receiver + physics task initialized");
 }
 
 // =============================================================================
 // SETUP
 // =============================================================================
 
+// =============================================================================
+// CHUNKED SERIES STREAMING
+// =============================================================================
+// /api/series is serialized one row at a time through AsyncWebServer's
+// chunked callback: the cursor is stepped only when the TCP stack asks for
+// more bytes, so peak heap is one serialized row (~200 B) regardless of how
+// many points the chart requests.  The cursor owns its statement because it
+// lives across callbacks on the async_tcp task.
+struct SeriesStream {
+  DBManager::SampleCursor cur;
+  char row[224];       // serialized row (or tail) being drained
+  size_t rowLen = 0;
+  size_t rowOff = 0;
+  bool first = true;
+  bool tailDone = false;
+};
+
+static size_t fillSeriesChunk(SeriesStream &st, uint8_t *buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (st.rowOff < st.rowLen) {
+      size_t n = st.rowLen - st.rowOff;
+      if (n > maxLen - written)
+        n = maxLen - written;
+      memcpy(buf + written, st.row + st.rowOff, n);
+      st.rowOff += n;
+      written += n;
+      continue;
+    }
+    if (st.tailDone)
+      break;   // written == 0 here signals end-of-response
+    DBManager::RowView r;
+    if (st.cur.next(r)) {
+      st.rowLen = snprintf(st.row, sizeof(st.row),
+                           "%s{\"timestamp\":%ld,\"theta\":%.4f,"
+                           "\"theta_2\":%.4f,\"raw_adc_2\":%d,"
+                           "\"temp_c\":%.1f,\"air_temp_c\":%.1f,"
+                           "\"theta_fc\":%.3f,\"theta_refill\":%.3f,"
+                           "\"humidity\":%.1f}",
+                           st.first ? "[" : ",", (long)r.timestamp, r.theta,
+                           r.theta_2, r.raw_adc_2, r.temp_c, r.air_temp_c,
+                           r.theta_fc, r.theta_refill, r.humidity);
+      // %f of a degenerate value (segment blocks carry no checksum) can
+      // outgrow the row buffer; truncate rather than drain past it.
+      if (st.rowLen >= sizeof(st.row))
+        st.rowLen = sizeof(st.row) - 1;
+      st.first = false;
+    } else {
+      st.rowLen = snprintf(st.row, sizeof(st.row), "%s",
+                           st.first ? "[]" : "]");
+      st.tailDone = true;
+    }
+    st.rowOff = 0;
+  }
+  return written;
+}
+
+// Rollup variant of the same mechanism.  The buckets arrive pre-aggregated
+// from SQLite as one vector of structs (a month of hourly buckets is ~40 KB,
+// versus ~170 KB for the JSON text the old String-building loop tried to
+// hold — more than the heap has in one piece) and are serialized one bucket
+// per callback, so the response itself costs one row of RAM.
+struct RollupStream {
+  std::vector<DBManager::SeriesPoint> buckets;
+  size_t idx = 0;      // next bucket to serialize
+  char row[256];       // serialized bucket (or tail) being drained
+  size_t rowLen = 0;
+  size_t rowOff = 0;
+  bool first = true;
+  bool tailDone = false;
+};
+
+static size_t fillRollupChunk(RollupStream &st, uint8_t *buf, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (st.rowOff < st.rowLen) {
+      size_t n = st.rowLen - st.rowOff;
+      if (n > maxLen - written)
+        n = maxLen - written;
+      memcpy(buf + written, st.row + st.rowOff, n);
+      st.rowOff += n;
+      written += n;
+      continue;
+    }
+    if (st.tailDone)
+      break;   // written == 0 here signals end-of-response
+    if (st.idx < st.buckets.size()) {
+      const DBManager::SeriesPoint &b = st.buckets[st.idx++];
+      st.rowLen = snprintf(st.row, sizeof(st.row),
+                           "%s{\"bucket\":%ld,\"n\":%d,"
+                           "\"theta_min\":%.4f,\"theta_max\":%.4f,"
+                           "\"theta_avg\":%.4f,\"theta_last\":%.4f,"
+                           "\"temp_min\":%.1f,\"temp_max\":%.1f,"
+                           "\"temp_avg\":%.1f,\"psi_min\":%.2f,"
+                           "\"psi_max\":%.2f,\"psi_avg\":%.2f}",
+                           st.first ? "[" : ",", (long)b.bucket, b.n,
+                           b.theta_min, b.theta_max, b.theta_avg,
+                           b.theta_last, b.temp_min, b.temp_max, b.temp_avg,
+                           b.psi_min, b.psi_max, b.psi_avg);
+      // %f of a degenerate aggregate can outgrow the row buffer; truncate
+      // rather than drain past it.
+      if (st.rowLen >= sizeof(st.row))
+        st.rowLen = sizeof(st.row) - 1;
+      st.first = false;
+    } else {
+      st.rowLen = snprintf(st.row, sizeof(st.row), "%s",
+                           st.first ? "[]" : "]");
+      st.tailDone = true;
+    }
+    st.rowOff = 0;
+  }
+  return written;
+}
+
 void setup() {
   Serial.begin(115200);
   delay(1000);
@@ -536,6 +1136,33 @@ void setup() {
   // Database
   if (!dbManager.init())
     Serial.println("[BOOT] DB Init Failed");
+  else if (!dbManager.startWriter())
+    Serial.println("[BOOT] DB writer task failed to start");
+
+  // Error log drain — just above idle, shares core 0 with physics
+  xTaskCreatePinnedToCore(errorLogDrainTask, "errlog", 4096, nullptr,
+                          1, nullptr, 0);
+
+  // Snapshot registration lock — must exist before the physics task or the
+  // sensor loop publish their first reading
+  snapRegisterMutex = xSemaphoreCreateMutex();
+
+  // Device registry — seed pairing state and last-seen before ESP-NOW starts
+  loadDeviceRegistry();
+
+  // Per-device engine pool: ring depth divided out of a fixed budget by
+  // the approved-device count (plus headroom for nodes that pair after
+  // boot), hub onboard engine in slot 0.  Failures here mean the hub
+  // boots with no working physics at all — say so loudly.
+  if (!engineManager.begin(deviceRegistry.size() + 4))
+    Serial.println("[BOOT] ERROR: engine pool init failed");
+  if (!engineManager.adopt("HUB_ONBOARD", &Physics))
+    Serial.println("[BOOT] ERROR: hub engine adoption failed - onboard "
+                   "sensor readings will be dropped");
+
+  // Prime the /api/devices snapshot so the first dashboard poll after
+  // boot sees the registry, not an empty list.
+  refreshDevicesSnapshot();
 
   // Physics engine - native C++, no Duktape
   if (loadThresholds() && activeCrop.loaded) {
@@ -547,8 +1174,10 @@ void setup() {
     Serial.println("[BOOT] Using physics defaults");
   }
 
-  // Issue 2: restore saved calibration state
+  // Issue 2: restore saved calibration state and rehydrate the history
+  // ring so the first live sample lands on a warm engine.
   loadCalibration("HUB_ONBOARD");
+  rehydrateHistory(&Physics, "HUB_ONBOARD");
 
   // WiFi AP
   WiFi.softAP("AgriScan_Connect", "agri1234");
@@ -572,6 +1201,25 @@ void setup() {
   server.serveStatic("/", SD, "/www/").setDefaultFile("index.html");
 
   server.on("/api/current", HTTP_GET, [](AsyncWebServerRequest *req) {
+    PERF_SCOPE("http.current");
+    // Fast path: serve the precomputed snapshot published by the last
+    // processed reading — no SQLite/SD access, no per-field String concats.
+    {
+      String devParam =
+          req->hasParam("device") ? req->getParam("device")->value() : "";
+      const char *devId =
+          devParam.length() ? devParam.c_str() : "HUB_ONBOARD";
+      DeviceSnapshot *snap = findSnapshot(devId);
+      if (snap) {
+        int live = snap->live.load(std::memory_order_acquire);
+        if (live >= 0) {
+          req->send(200, "application/json", snap->buf[live]);
+          return;
+        }
+      }
+    }
+    // Slow path: nothing published yet this boot (e.g. dashboards polling
+    // before the first reading) — fall back to the original lookups.
     if (req->hasParam("device")) {
       String devId = req->getParam("device")->value();
       SampleData s = dbManager.getLatestSampleForDevice(devId);
@@ -589,9 +1237,9 @@ void setup() {
       json += "\"aw_mm\":" + String(s.aw_mm, 1) + ",";
       json += "\"fractionDepleted\":" + String(s.fraction_depleted, 3) + ",";
       json += "\"dryingRate_per_hr\":" + String(s.drying_rate, 4) + ",";
-      json += "\"regime\":\"" + s.regime + "\",";
-      json += "\"status\":\"" + s.status + "\",";
-      json += "\"urgency\":\"" + s.urgency + "\",";
+      json += "\"regime\":\"" + String(s.regime) + "\",";
+      json += "\"status\":\"" + String(s.status) + "\",";
+      json += "\"urgency\":\"" + String(s.urgency) + "\",";
       json += "\"qc_valid\":" + String(s.qc_valid ? "true" : "false") + ",";
       json += "\"confidence\":" + String(s.confidence, 2) + ",";
       json += "\"battery_pct\":" + String(s.battery_pct);
@@ -620,8 +1268,8 @@ void setup() {
     json +=
       "\"dryingRate_per_hr\":" + String(lastReading.dryingRate_per_hr, 4) + ",";
     json += "\"regime\":\"" + String(lastReading.regime) + "\",";
-    json += "\"status\":\"" + s.status + "\",";
-    json += "\"urgency\":\"" + s.urgency + "\",";
+    json += "\"status\":\"" + String(s.status) + "\",";
+    json += "\"urgency\":\"" + String(s.urgency) + "\",";
     json +=
       "\"recommendation\":\"" + String(lastReading.recommendation) + "\",";
     json += "\"calibration_state\":\"" + String(lastReading.calibration_state) + "\",";
@@ -637,62 +1285,66 @@ void setup() {
   });
 
   server.on("/api/series", HTTP_GET, [](AsyncWebServerRequest *req) {
+    PERF_SCOPE("http.series");
+    // Long ranges are served from the write-time rollup tables:
+    // ?res=hour|day with start/end (unix seconds) returns pre-aggregated
+    // buckets instead of raw samples.
+    if (req->hasParam("res") && req->hasParam("start") && req->hasParam("end")) {
+      String res = req->getParam("res")->value();
+      int resolution_s = (res == "day") ? 86400 : 3600;
+      time_t start = (time_t)req->getParam("start")->value().toInt();
+      time_t end = (time_t)req->getParam("end")->value().toInt();
+      String devId = "HUB_ONBOARD";
+      if (req->hasParam("device"))
+        devId = req->getParam("device")->value();
+
+      // Chunked like the raw path below — a month of hourly buckets as one
+      // String is ~170 KB, which the heap cannot hold in one piece.
+      auto st = std::make_shared<RollupStream>();
+      st->buckets =
+          dbManager.getSeriesAggregated(start, end, resolution_s, devId);
+      AsyncWebServerResponse *resp = req->beginChunkedResponse(
+          "application/json",
+          [st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+            return fillRollupChunk(*st, buffer, maxLen);
+          });
+      req->send(resp);
+      return;
+    }
+
     int limit = 144;
     if (req->hasParam("limit"))
       limit = req->getParam("limit")->value().toInt();
-    if (limit < 1 || limit > 200)
+    // Streaming removed the old 200-point heap ceiling; cap at one day of
+    // 30 s samples to keep a single request from monopolizing the SD bus.
+    if (limit < 1 || limit > 2880)
       limit = 144;
 
     String devId = "HUB_ONBOARD";
     if (req->hasParam("device"))
       devId = req->getParam("device")->value();
-    auto series = (devId == "HUB_ONBOARD") ? dbManager.getRecentSamples(limit)
-                                           : dbManager.getRecentSamples(limit, devId);
-    String json = "[";
-    for (size_t i = 0; i < series.size(); i++) {
-      if (i > 0)
-        json += ",";
-      json += "{\"timestamp\":" + String(series[i].timestamp) + ",";
-      json += "\"theta\":" + String(series[i].theta, 4) + ",";
-      json += "\"theta_2\":" + String(series[i].theta_2, 4) + ",";
-      json += "\"raw_adc_2\":" + String(series[i].raw_adc_2) + ",";
-      json += "\"temp_c\":" + String(series[i].temp_c, 1) + ",";
-      json += "\"air_temp_c\":" + String(series[i].air_temp_c, 1) + ",";
-      json += "\"theta_fc\":" + String(series[i].theta_fc, 3) + ",";
-      json += "\"theta_refill\":" + String(series[i].theta_refill, 3) + ",";
-      json += "\"humidity\":" + String(series[i].humidity, 1) + "}";
-    }
-    json += "]";
-    req->send(200, "application/json", json);
-  });
 
-  server.on("/api/devices", HTTP_GET, [](AsyncWebServerRequest *req) {
-    DynamicJsonDocument doc(4096);
-    File f = SD.open("/config/paired_devices.json", FILE_READ);
-    if (f) {
-      deserializeJson(doc, f);
-      f.close();
+    // Chunked streaming: rows are pulled from the cursor as the TCP stack
+    // drains the response, never building the full JSON in RAM.
+    auto st = std::make_shared<SeriesStream>();
+    if (!dbManager.openRecentSamples(st->cur, limit, devId)) {
+      req->send(500, "application/json", "{\"error\":\"db\"}");
+      return;
     }
-    if (!doc.containsKey("devices"))
-      doc.createNestedArray("devices");
+    AsyncWebServerResponse *resp = req->beginChunkedResponse(
+        "application/json",
+        [st](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+          return fillSeriesChunk(*st, buffer, maxLen);
+        });
+    req->send(resp);
+  });
 
-    String json = "[";
-    bool first = true;
-    for (JsonObject dev : doc["devices"].as<JsonArray>()) {
-      if (!first)
-        json += ",";
-      first = false;
-      String mac = dev["mac"] | "";
-      bool paired = dev["paired"] | false;
-      bool online = (deviceEngines.find(mac) != deviceEngines.end());
-      time_t lastSeen = dbManager.getDeviceLastSeen(mac);
-      json += "{\"mac\":\"" + mac + "\",";
-      json += "\"paired\":" + String(paired ? "true" : "false") + ",";
-      json += "\"online\":" + String(online ? "true" : "false") + ",";
-      json += "\"last_seen\":" + String((long)lastSeen) + "}";
-    }
-    json += "]";
-    req->send(200, "application/json", json);
+  server.on("/api/devices", HTTP_GET, [](AsyncWebServerRequest *req) {
+    PERF_SCOPE("http.devices");
+    // Pre-serialized snapshot, refreshed from loop() — the handler does
+    // no registry walk and builds no Strings per poll.
+    int live = devicesJsonLive.load(std::memory_order_acquire);
+    req->send(200, "application/json", devicesJson[live]);
   });
 
   server.on("/api/devices/approve", HTTP_POST, [](AsyncWebServerRequest *req) {
@@ -730,11 +1382,24 @@ void setup() {
     }
     serializeJson(doc, fw);
     fw.close();
+
+    // Mirror the new pairing state into the RAM registry so the ingest
+    // path accepts the device immediately.
+    uint8_t macBytes[6];
+    if (DeviceRegistry::parseMac(mac.c_str(), macBytes)) {
+      DeviceEntry *e = deviceRegistry.findOrAdd(macBytes);
+      if (e) {
+        e->paired = true;
+        e->announced = true;
+      }
+    }
+
     Serial.printf("[PAIR] Approved %s\n", mac.c_str());
     req->send(200, "application/json", "{\"success\":true}");
   });
 
   server.on("/api/config", HTTP_GET, [](AsyncWebServerRequest *req) {
+    PERF_SCOPE("http.config");
     File f = SD.open("/config/user_prefs.json", FILE_READ);
     if (!f) {
       req->send(200, "application/json", "{\"onboarding_complete\":false}");
@@ -769,13 +1434,14 @@ void setup() {
     });
 
   server.on("/api/diagnostics", HTTP_GET, [](AsyncWebServerRequest *req) {
+    PERF_SCOPE("http.diagnostics");
     String json = "{";
     json += "\"free_heap\":" + String(ESP.getFreeHeap()) + ",";
     json += "\"uptime_s\":" + String(millis() / 1000) + ",";
     json += "\"sample_count\":" + String(seqTimestamp - 1000000) + ",";
     json += "\"crop\":\"" + activeCrop.crop_key + "\",";
     json += "\"soil\":\"" + activeCrop.soil_key + "\",";
-    json += "\"paired_devices\":" + String(deviceEngines.size());
+    json += "\"paired_devices\":" + String(engineManager.count() - 1);
     json += ",\"calibration\":{";
     auto cs = Physics.getCalibrationState();
     const char* stateNames[] = {"INIT","BASELINE_MONITORING","WETTING_EVENT","DRAINAGE_TRACKING","FC_ESTIMATE","DRYDOWN_FIT","NORMAL_OPERATION"};
@@ -786,6 +1452,12 @@ void setup() {
     json += "\"theta_fc_star\":" + String(cs.theta_fc_star, 4) + ",";
     json += "\"n_fc_updates\":" + String(cs.n_fc_updates);
     json += "}";
+    // Hot-path latency histograms (see perf_timer.h): p50/p99/max per
+    // stage, from the same counters the scoped timers feed in the field.
+    static char timings[2048];
+    PerfRegistry::toJson(timings, sizeof(timings));
+    json += ",\"timings\":";
+    json += timings;
     json += "}";
     req->send(200, "application/json", json);
   });
@@ -811,6 +1483,14 @@ void setup() {
     req->send(SD, "/logs/readings.csv", "text/csv", true);
   });
 
+  // Most recent sensor errors, straight from the RAM tail — responds
+  // instantly even when the SD card is busy with a write burst.
+  server.on("/api/logs/errors", HTTP_GET, [](AsyncWebServerRequest *req) {
+    static char tail[2048];
+    errorLog.tailCsv(tail, sizeof(tail));
+    req->send(200, "text/csv", tail);
+  });
+
   server.on("/api/logs/clear", HTTP_DELETE, [](AsyncWebServerRequest *req) {
     if (SD.exists("/logs/readings.csv"))
       SD.remove("/logs/readings.csv");
@@ -852,8 +1532,125 @@ void setup() {
 // MAIN LOOP
 // =============================================================================
 
+// =============================================================================
+// SERIAL-TRIGGERED DB BENCHMARK
+// =============================================================================
+// Companion to host/dbbench: typing `dbbench` on the serial console runs a
+// scaled-down version of the same scenarios against the real SD card and
+// sqlite3 port, printing the same JSON lines so host numbers can be
+// anchored to device numbers per release.  The bench writes real rows
+// (device BENCH_DEV, timestamps ~400 days in the past) into the live
+// store — run it on a bench unit, not a production hub.
+
+void runDbBenchmark() {
+  Serial.println("[BENCH] Starting DB benchmark");
+  const time_t base = time(nullptr) - 400L * 86400L;
+  const int batchSizes[] = { 16, 64, 256 };
+
+  std::vector<SampleData> batch;
+  for (int b : batchSizes) {
+    const int total = 256;
+    batch.reserve(b);
+    unsigned long t0 = millis();
+    for (int i = 0; i < total;) {
+      batch.clear();
+      int n = min(b, total - i);
+      for (int j = 0; j < n; j++) {
+        SampleData s;
+        s.timestamp = base + (time_t)(i + j) * 15;
+        s.raw_adc = 1500 + (i + j) % 700;
+        s.temp_c = 22.0f;
+        s.theta = 0.25f;
+        s.theta_fc = 0.31f;
+        s.theta_refill = 0.21f;
+        s.psi_kpa = -30.0f;
+        s.aw_mm = 25.0f;
+        s.fraction_depleted = 0.4f;
+        s.drying_rate = 0.002f;
+        s.setRegime("drydown");
+        s.setStatus("ok");
+        s.setUrgency("none");
+        s.confidence = 0.8f;
+        s.qc_valid = true;
+        s.seq = i + j;
+        s.setDeviceId("BENCH_DEV");
+        batch.push_back(s);
+      }
+      dbManager.writeSampleBatch(batch);
+      i += n;
+    }
+    unsigned long wall = millis() - t0;
+    Serial.printf("{\"bench\":\"write_batch\",\"batch_rows\":%d,"
+                  "\"rows\":%d,\"wall_ms\":%lu,\"rows_per_s\":%lu}\n",
+                  b, total, wall, wall ? total * 1000UL / wall : 0);
+  }
+
+  const int iters = 10;
+  unsigned long recentUs = 0, recentMaxUs = 0;
+  unsigned long rangeUs = 0, rangeMaxUs = 0;
+  time_t now = time(nullptr);
+  for (int i = 0; i < iters; i++) {
+    unsigned long t0 = micros();
+    dbManager.getRecentSamples(100);
+    unsigned long d1 = micros() - t0;
+    recentUs += d1;
+    if (d1 > recentMaxUs) recentMaxUs = d1;
+
+    t0 = micros();
+    dbManager.getSamplesInRange(now - 86400, now);
+    unsigned long d2 = micros() - t0;
+    rangeUs += d2;
+    if (d2 > rangeMaxUs) rangeMaxUs = d2;
+  }
+  Serial.printf("{\"bench\":\"read_recent\",\"iters\":%d,\"avg_ms\":%.2f,"
+                "\"max_ms\":%.2f}\n",
+                iters, recentUs / 1000.0 / iters, recentMaxUs / 1000.0);
+  Serial.printf("{\"bench\":\"read_range\",\"iters\":%d,\"avg_ms\":%.2f,"
+                "\"max_ms\":%.2f}\n",
+                iters, rangeUs / 1000.0 / iters, rangeMaxUs / 1000.0);
+
+  // Retention purges the bench partitions while we time the stall.
+  unsigned long t0 = millis();
+  dbManager.cleanOldData(365);
+  Serial.printf("{\"bench\":\"clean_old\",\"keep_days\":365,"
+                "\"wall_ms\":%lu}\n", millis() - t0);
+
+  t0 = millis();
+  int removed = dbManager.deduplicateRows();
+  Serial.printf("{\"bench\":\"dedup\",\"removed\":%d,\"wall_ms\":%lu}\n",
+                removed, millis() - t0);
+  Serial.println("[BENCH] Done");
+}
+
+void pollSerialCommands() {
+  static char cmd[24];
+  static int len = 0;
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\n' || c == '\r') {
+      cmd[len] = 0;
+      if (len > 0 && strcmp(cmd, "dbbench") == 0)
+        runDbBenchmark();
+      len = 0;
+    } else if (len < (int)sizeof(cmd) - 1) {
+      cmd[len++] = c;
+    }
+  }
+}
+
 void loop() {
   static unsigned long lastSample = 0;
+  static unsigned long lastDevicesRefresh = 0;
+
+  pollSerialCommands();
+
+  // Rebuild the /api/devices snapshot and flush dirty last-seen values;
+  // both are registry walks plus at most one upsert per device per minute.
+  if (millis() - lastDevicesRefresh > 5000) {
+    lastDevicesRefresh = millis();
+    refreshDevicesSnapshot();
+    persistDirtyLastSeen();
+  }
 
   if (millis() - lastSample > 2000) {
     lastSample = millis();
@@ -922,24 +1719,48 @@ void loop() {
       s.aw_mm = s1Valid ? reading.AW_mm : -1.0f;
       s.fraction_depleted = s1Valid ? reading.fractionDepleted : -1.0f;
       s.drying_rate = s1Valid ? reading.dryingRate_per_hr : -1.0f;
-      s.regime = s1Valid ? String(reading.regime) : "unknown";
-      s.status = s1Valid ? String(reading.status) : "no_soil";
-      s.urgency = s1Valid ? String(reading.urgency) : "none";
+      s.setRegime(s1Valid ? reading.regime : "unknown");
+      s.setStatus(s1Valid ? reading.status : "no_soil");
+      s.setUrgency(s1Valid ? reading.urgency : "none");
       s.confidence = s1Valid ? reading.confidence : 0.0f;
       s.qc_valid = s1Valid ? reading.qc_valid : false;
       s.seq = (int)(seqTimestamp - 1000000);
       lastCachedSample = s;
 
-      sampleBuffer.push_back(s);
-      if ((int)sampleBuffer.size() >= BATCH_SIZE) {
-        dbManager.writeSampleBatch(sampleBuffer);
-        sampleBuffer.clear();
-        Serial.println("[DB] Batch flushed");
-      }
+      dbManager.queueSample(s);
+
+      // Publish the hub /api/current snapshot — same field set as the old
+      // handler, serialized once here instead of on every poll.
+      char snap[SNAPSHOT_JSON_MAX];
+      snprintf(snap, sizeof(snap),
+               "{\"timestamp\":%ld,\"raw_adc\":%d,\"raw_adc_2\":%d,"
+               "\"temp_c\":%.1f,\"soil_temp_c\":%.1f,\"air_temp_c\":%.1f,"
+               "\"humidity\":%.1f,\"theta\":%.4f,\"theta_2\":%.4f,"
+               "\"psi_kpa\":%.2f,\"aw_mm\":%.1f,\"Se\":%.4f,"
+               "\"TAW_mm\":%.1f,\"Dr_mm\":%.1f,\"fractionDepleted\":%.3f,"
+               "\"dryingRate_per_hr\":%.4f,\"regime\":\"%s\","
+               "\"status\":\"%s\",\"urgency\":\"%s\","
+               "\"recommendation\":\"%s\",\"calibration_state\":\"%s\","
+               "\"qc_valid\":%s,\"confidence\":%.2f,\"theta_fc\":%.3f,"
+               "\"theta_refill\":%.3f,\"stage\":\"%s\",\"crop\":\"%s\"}",
+               (long)s.timestamp, s.raw_adc, s.raw_adc_2,
+               lastReading.temp_c, lastReading.temp_c, lastAirTemp,
+               lastHumidity, s.theta, s.theta_2, s.psi_kpa, s.aw_mm,
+               lastReading.Se, lastReading.TAW_mm, lastReading.Dr_mm,
+               lastReading.fractionDepleted, lastReading.dryingRate_per_hr,
+               lastReading.regime, s.status, s.urgency,
+               lastReading.recommendation, lastReading.calibration_state,
+               lastReading.qc_valid ? "true" : "false", s.confidence,
+               activeCrop.theta_fc, activeCrop.theta_refill,
+               activeCrop.stage_name.c_str(), activeCrop.crop_key.c_str());
+      publishCurrentSnapshot("HUB_ONBOARD", snap);
 
       if (s1Valid) {
-        if (millis() - lastCalSaveMillis > CAL_SAVE_INTERVAL_MS) {
-            saveCalibration("HUB_ONBOARD");
+        if (Physics.calibrationDirty()) {
+            saveCalibration("HUB_ONBOARD", true);
+            lastCalSaveMillis = millis();
+        } else if (millis() - lastCalSaveMillis > CAL_SAVE_INTERVAL_MS) {
+            saveCalibration("HUB_ONBOARD", false);
             lastCalSaveMillis = millis();
         }
       }
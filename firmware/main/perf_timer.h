@@ -0,0 +1,115 @@
+#ifndef PERF_TIMER_H
+#define PERF_TIMER_H
+
+#include <Arduino.h>
+
+// =============================================================================
+// HOT-PATH TIMING — SCOPED TIMERS + LOG2 HISTOGRAMS
+// =============================================================================
+// Field diagnosis layer: fixed-bucket log2 latency histograms in static
+// RAM, fed by scoped timers around the physics stages, the batch writer
+// and the HTTP handlers, and served as JSON from /api/diagnostics.
+//
+// Cost per sample is one micros() pair (esp_timer_get_time() underneath
+// on the ESP32) and one increment — cheap enough to leave on in
+// production.  Counters are plain uint32 and may race between the
+// physics task and the web task; a diagnostic histogram does not need
+// atomics, and a torn read costs at most one miscounted sample.
+
+struct PerfHistogram {
+    // Bucket i counts durations whose upper bound is 2^i µs; the last
+    // bucket (i = 19, ~524 ms) also absorbs everything slower.
+    static const int BUCKETS = 20;
+
+    uint32_t counts[BUCKETS] = {};
+    uint64_t sumUs = 0;
+    uint32_t n = 0;
+    uint32_t maxUs = 0;
+
+    void record(uint32_t us) {
+        int i = (us == 0) ? 0 : 32 - __builtin_clz(us);
+        if (i >= BUCKETS) i = BUCKETS - 1;
+        counts[i]++;
+        sumUs += us;
+        n++;
+        if (us > maxUs) maxUs = us;
+    }
+
+    // Bucket-upper-bound estimate of the given percentile (0-100).
+    uint32_t percentileUs(int pct) const {
+        if (n == 0) return 0;
+        uint32_t rank = (uint32_t)(((uint64_t)n * pct + 99) / 100);
+        uint32_t cum = 0;
+        for (int i = 0; i < BUCKETS; i++) {
+            cum += counts[i];
+            if (cum >= rank) return 1u << i;
+        }
+        return 1u << (BUCKETS - 1);
+    }
+};
+
+// Fixed-slot registry; names must be string literals (compared by
+// pointer first, strcmp only on collision), and the PERF_SCOPE macro
+// caches the slot in a function-local static so the lookup runs once.
+class PerfRegistry {
+public:
+    static const int MAX_TIMERS = 16;
+
+    static PerfHistogram& slot(const char* name) {
+        for (int i = 0; i < _count; i++)
+            if (_names[i] == name || strcmp(_names[i], name) == 0)
+                return _hists[i];
+        if (_count < MAX_TIMERS) {
+            _names[_count] = name;
+            return _hists[_count++];
+        }
+        return _overflow;   // out of slots: count, but anonymously
+    }
+
+    // {"name":{"n":..,"avg_us":..,"p50_us":..,"p99_us":..,"max_us":..},...}
+    // Returns bytes written (excluding the NUL).
+    static size_t toJson(char* buf, size_t cap) {
+        size_t off = 0;
+        off += snprintf(buf + off, cap - off, "{");
+        for (int i = 0; i < _count && off < cap; i++) {
+            const PerfHistogram& h = _hists[i];
+            off += snprintf(buf + off, cap - off,
+                            "%s\"%s\":{\"n\":%lu,\"avg_us\":%lu,"
+                            "\"p50_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu}",
+                            i ? "," : "", _names[i], (unsigned long)h.n,
+                            (unsigned long)(h.n ? h.sumUs / h.n : 0),
+                            (unsigned long)h.percentileUs(50),
+                            (unsigned long)h.percentileUs(99),
+                            (unsigned long)h.maxUs);
+        }
+        if (off < cap)
+            off += snprintf(buf + off, cap - off, "}");
+        return off;
+    }
+
+private:
+    static const char* _names[MAX_TIMERS];
+    static PerfHistogram _hists[MAX_TIMERS];
+    static PerfHistogram _overflow;
+    static int _count;
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(PerfHistogram& h) : _h(h), _t0(micros()) {}
+    ~ScopedTimer() { _h.record((uint32_t)(micros() - _t0)); }
+
+private:
+    PerfHistogram& _h;
+    unsigned long _t0;
+};
+
+#define PERF_CAT2(a, b) a##b
+#define PERF_CAT(a, b) PERF_CAT2(a, b)
+// Times the enclosing scope under `name` (a string literal).
+#define PERF_SCOPE(name)                                                   \
+    static PerfHistogram& PERF_CAT(_perfHist, __LINE__) =                  \
+        PerfRegistry::slot(name);                                          \
+    ScopedTimer PERF_CAT(_perfScope, __LINE__)(PERF_CAT(_perfHist, __LINE__))
+
+#endif // PERF_TIMER_H
@@ -4,15 +4,13 @@
 #include <Arduino.h>
 #include <math.h>
 
+#include "history_buffer.h"
+#include "rolling_stats.h"
+
 // =============================================================================
 // CONFIGURATION & CONSTANTS
 // =============================================================================
 
-// History buffer size - 288 = 3 days at 15-min intervals
-// Reduced from JS 2880 to fit ESP32 RAM
-#define HISTORY_MAX 288
-#define FC_HISTORY_MAX 16
-
 struct PhysicsConfig {
     // Pre-processing & QC
     float spike_z_thresh   = 6.0f;
@@ -46,6 +44,10 @@ struct PhysicsConfig {
     float kd_init   = 0.05f;
     float ku_init   = 0.0005f;
     float beta_init = 1.0f;
+
+    // Soil model retention-curve lookup tables (see SoilModel).  Disable to
+    // validate against the exact powf path.
+    bool use_vg_lut = true;
 };
 
 extern PhysicsConfig CONFIG;
@@ -54,14 +56,6 @@ extern PhysicsConfig CONFIG;
 // DATA STRUCTURES
 // =============================================================================
 
-struct DataPoint {
-    time_t  timestamp;
-    int     raw;
-    float   temp_c;
-    float   theta;
-    bool    qc_valid;
-};
-
 struct QCResult {
     bool  valid;
     char  flags[64];   // comma-separated flag string
@@ -151,7 +145,8 @@ public:
     float temperatureCorrection(float theta, float temp_c);
     float calibrate(int raw, float temp_c);
     QCResult qualityControl(float theta, float temp_c,
-                            DataPoint* history, int historyLen);
+                            const HistoryBuffer& history,
+                            const HistoryStats& stats);
 
 private:
     static const int NUM_CAL_POINTS = 5;
@@ -188,6 +183,26 @@ public:
     float effectiveSaturation(float theta);
     float hydraulicConductivity(float theta);
     AvailableWater availableWater(float theta, float rootDepth_cm = 30.0f);
+
+    // Rebuild the retention-curve lookup tables from the active params.
+    // Called by the constructors and whenever configureCropSoil swaps the
+    // soil parameters.
+    void rebuildLookupTables();
+
+private:
+    // Piecewise lookup tables for the three powf-heavy kernels: theta over a
+    // log-spaced psi grid, log(psi) and log(K) over a uniform Se grid.
+    // powf costs hundreds of cycles on the ESP32; a table walk plus linear
+    // interpolation is ~20.  Exact paths retained (CONFIG.use_vg_lut).
+    static const int VG_LUT_SIZE = 256;   // 3 KB total — ln(psi)/ln(K) need
+                                          // the density near the Se grid ends
+    float lutTheta[VG_LUT_SIZE];     // theta over log10(psi) grid
+    float lutLogPsi[VG_LUT_SIZE];    // ln(psi_cm) over Se grid
+    float lutLogK[VG_LUT_SIZE];      // ln(K) over Se grid
+
+    float vanGenuchten_theta_exact(float psi_cm);
+    float vanGenuchten_psi_exact(float theta);
+    float hydraulicConductivity_exact(float theta);
 };
 
 // =============================================================================
@@ -198,12 +213,12 @@ class EventDetection {
 public:
     EventDetection();
 
-    bool  detectWetting(DataPoint* history, int len, float* delta_theta_out);
-    float calculateDryingRate(DataPoint* history, int len,
+    bool  detectWetting(const HistoryBuffer& history, float* delta_theta_out);
+    float calculateDryingRate(const HistoryBuffer& history,
                               uint32_t windowSeconds = 0);
-    bool  detectFCPlateau(DataPoint* history, int len,
+    bool  detectFCPlateau(const HistoryBuffer& history,
                           float* theta_fc_candidate_out);
-    void  classifyRegime(DataPoint* history, int len,
+    void  classifyRegime(const HistoryBuffer& history,
                          float theta_fc, char* regimeOut);
 
     time_t lastEventTime = 0;
@@ -231,11 +246,43 @@ public:
 
     float drainageRate(float theta, float theta_fc);
     float drydownRate(float theta);
-    bool  fitDrainageParameter(DataPoint* data, int len,
-                               float theta_fc, float* kd_out);
-    bool  fitDrydownParameters(DataPoint* data, int len,
-                               float* ku_out, float* beta_out,
-                               float* theta_min_out);
+
+    // Per-segment sufficient statistics.  The fits used to rescan the
+    // full 30-day history (logs and divisions per point) every time the
+    // calibration machine wanted parameters; instead the running sums
+    // are maintained as points arrive — the log is paid once per sample
+    // — and a refit is a handful of arithmetic regardless of window
+    // length, cheap enough to run on every sample.  AutoCalibration
+    // resets the segments at wetting-event boundaries.
+
+    // Drainage: log-linear regression of ln(theta - theta_fc) on hours
+    // since segment start.  theta_fc is sampled at accumulation time;
+    // the EWMA moves it slowly enough that the residuals stay honest.
+    struct DrainStats {
+        float  sumX = 0, sumY = 0, sumXY = 0, sumX2 = 0;
+        int    n = 0;
+        time_t t0 = 0;
+        void reset() { *this = DrainStats(); }
+    };
+
+    // Drydown: exponential-decay envelope — first/last/min of the
+    // segment is all the closed-form estimate needs.
+    struct DrySegment {
+        float  theta0 = 0, thetaLast = 0, thetaMin = 0;
+        time_t tStart = 0, tLast = 0;
+        int    n = 0;
+        void reset() { *this = DrySegment(); }
+    };
+
+    void resetSegments() { drain.reset(); dry.reset(); }
+    void accumulateDrainage(time_t ts, float theta, float theta_fc);
+    void accumulateDrydown(time_t ts, float theta);
+    bool fitDrainageFromStats(float* kd_out) const;
+    bool fitDrydownFromStats(float* ku_out, float* beta_out,
+                             float* theta_min_out) const;
+
+    DrainStats drain;
+    DrySegment dry;
 };
 
 // =============================================================================
@@ -262,16 +309,59 @@ struct CalibrationResult {
     float qc_pass_rate;
 };
 
+// Fixed-layout warm-boot snapshot: the public CalibrationResult plus the
+// pieces a JSON round trip loses — the FC estimate history, the pending FC
+// candidate, and the fitted dynamics parameters.  Written to SD verbatim
+// (one write, no serializer) on every calibration state transition and fed
+// back through restoreCalibrationSnapshot at boot, so the hub resumes in
+// CAL_NORMAL_OPERATION instead of spending days re-learning theta_fc.
+static const uint32_t CAL_SNAPSHOT_MAGIC   = 0x53434741;   // "AGCS"
+static const uint16_t CAL_SNAPSHOT_VERSION = 1;
+
+struct __attribute__((packed)) CalibrationSnapshot {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    int32_t  state;
+    float    theta_fc_star;
+    float    theta_refill_star;
+    float    confidence;
+    int32_t  n_events;
+    int32_t  n_fc_updates;
+    float    qc_pass_rate;
+    // DynamicsParams
+    float    kd;
+    float    ku;
+    float    beta;
+    float    theta_min;
+    // AutoCalibration internals
+    float    fc_history[FC_HISTORY_MAX];
+    int32_t  fc_history_len;
+    float    fc_candidate;
+};
+
 class AutoCalibration {
 public:
     AutoCalibration(SoilModel* soilModel,
                     EventDetection* eventDetection,
                     DynamicsModel* dynamicsModel);
 
-    void             update(DataPoint& point, DataPoint* history, int historyLen);
+    void             update(DataPoint& point, const HistoryBuffer& history,
+                            const HistoryStats& stats);
     CalibrationResult getCalibrationState();
     void restoreCalibrationState(const CalibrationResult& r);
 
+    // Full binary snapshot (see CalibrationSnapshot above).
+    void getSnapshot(CalibrationSnapshot& out);
+    void restoreSnapshot(const CalibrationSnapshot& s);
+    // True once after each state-machine transition; cleared by the read.
+    // The caller persists a snapshot when it sees the flag.
+    bool consumeDirty() {
+        bool d = dirty;
+        dirty = false;
+        return d;
+    }
+
     float theta_fc_star     = -1.0f;   // -1 = not yet set
     float theta_refill_star = -1.0f;
 
@@ -281,6 +371,7 @@ private:
     DynamicsModel*  dynamicsModel;
 
     CalibrationState state = CAL_INIT;
+    bool dirty = false;   // set by update() on state transitions
 
     float    fc_history[FC_HISTORY_MAX];
     int      fc_history_len = 0;
@@ -295,14 +386,16 @@ private:
         int   qc_total_count= 0;
     } stats;
 
-    void state_init(DataPoint* history, int len);
-    void state_baseline(DataPoint& point, DataPoint* history, int len);
+    void state_init(const HistoryBuffer& history, const HistoryStats& stats);
+    void state_baseline(DataPoint& point, const HistoryBuffer& history);
     void state_wetting(DataPoint& point);
-    void state_drainage(DataPoint& point, DataPoint* history, int len);
-    void state_fc_estimate(DataPoint* history, int len);
-    void state_drydown_fit(DataPoint* history, int len);
-    void state_normal(DataPoint& point, DataPoint* history, int len);
-    void updateRefillThreshold(DataPoint* history, int len);
+    void state_drainage(DataPoint& point, const HistoryBuffer& history);
+    void state_fc_estimate(const HistoryBuffer& history,
+                           const HistoryStats& stats);
+    void state_drydown_fit(const HistoryBuffer& history);
+    void state_normal(DataPoint& point, const HistoryBuffer& history);
+    void updateRefillThreshold(const HistoryBuffer& history,
+                               const HistoryStats& stats);
     void updateConfidence();
 
     const char* stateToString(CalibrationState s);
@@ -332,11 +425,55 @@ public:
 
     SensorReading processSensorReading(int raw, float temp_c, time_t timestamp);
 
+    // One row of a backlog batch: timestamp/raw/temp_c are inputs, the
+    // batch pass fills theta and qc_valid so the caller can store every
+    // row without a second calibration pass.
+    struct BatchPoint {
+        time_t timestamp;
+        int    raw;
+        float  temp_c;
+        float  theta;
+        bool   qc_valid;
+    };
+
+    // Backlog drain: calibrates, QC-checks and history-appends a
+    // same-device, time-ascending batch in one dense pass, running the
+    // full metrics computation (matric potential, available water,
+    // drying-rate regression, regime) only for the newest point.
+    // Returns that newest reading — identical to feeding the rows
+    // through processSensorReading one at a time and keeping the last
+    // result, minus n-1 redundant metrics computations.
+    SensorReading processSensorBatch(BatchPoint* rows, int n);
+
     // Getters for external use
     CalibrationResult getCalibrationState();
     void              restoreCalibrationState(const CalibrationResult& r);
-    int               historyLen() { return _historyLen; }
-    DataPoint*        getHistory() { return _history; }
+    int               historyLen() { return _history.len(); }
+    const HistoryBuffer& getHistory() { return _history; }
+
+    // Hands the engine its ring storage — at least
+    // HistoryBuffer::bytesFor(points), capacity chosen by the caller (see
+    // engine_manager.h).  Must run before the first processSensorReading;
+    // until then the engine runs with an empty, drop-everything history.
+    void bindHistoryStorage(uint8_t* mem, int points = HISTORY_MAX) {
+        _history.bindStorage(mem, points);
+    }
+
+    // Warm-boot persistence (see CalibrationSnapshot)
+    void getCalibrationSnapshot(CalibrationSnapshot& out) {
+        autoCalibration.getSnapshot(out);
+    }
+    void restoreCalibrationSnapshot(const CalibrationSnapshot& s) {
+        autoCalibration.restoreSnapshot(s);
+    }
+    bool calibrationDirty() { return autoCalibration.consumeDirty(); }
+
+    // Warm-boot history rehydration: prepend stored points newest-first
+    // (the order DB cursors yield them), then call finishRehydration() to
+    // rebuild the streaming stats.  Only valid before the first live
+    // sample; rehydrateHistoryPoint returns false once the ring is full.
+    bool rehydrateHistoryPoint(const DataPoint& p);
+    void finishRehydration();
 
     DrainageQuality   assessDrainageQuality();
     IrrigationStatus  getIrrigationStatus(float theta, float theta_fc,
@@ -350,8 +487,8 @@ private:
     AutoCalibration   autoCalibration;
     ExternalConfig    extConfig;
 
-    DataPoint _history[HISTORY_MAX];
-    int       _historyLen = 0;
+    HistoryBuffer _history;
+    HistoryStats  _stats;
 
     void pushHistory(DataPoint& p);
     void calculateMetrics(DataPoint& point, SensorReading& out);
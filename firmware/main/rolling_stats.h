@@ -0,0 +1,241 @@
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <Arduino.h>
+#include <math.h>
+
+// =============================================================================
+// STREAMING STATISTICS — O(1) PER SAMPLE
+// =============================================================================
+// Incremental counterparts of the per-sample window recomputations that QC
+// and the refill-threshold update used to do: rolling sum/sum-of-squares for
+// the z-score spike check, monotonic min/max deques for the stuck-sensor
+// check, and a P² online quantile estimator for theta_dry.  All fixed-size,
+// no heap.
+
+// Fixed-window rolling mean / standard deviation.
+// Maintains sum and sum-of-squares over the last `window` values pushed.
+class RollingWindowStats {
+public:
+    static const int MAX_WINDOW = 16;
+
+    explicit RollingWindowStats(int window = 5) { reset(window); }
+
+    void reset(int window) {
+        _window = (window > MAX_WINDOW) ? MAX_WINDOW : window;
+        _head = 0; _count = 0;
+        _sum = 0.0f; _sumSq = 0.0f;
+    }
+
+    void push(float v) {
+        if (_count == _window) {
+            float old = _ring[_head];
+            _sum   -= old;
+            _sumSq -= old * old;
+        } else {
+            _count++;
+        }
+        _ring[_head] = v;
+        _head = (_head + 1 == _window) ? 0 : _head + 1;
+        _sum   += v;
+        _sumSq += v * v;
+    }
+
+    int   count() const { return _count; }
+    float mean()  const { return (_count > 0) ? _sum / _count : 0.0f; }
+
+    // Population std-dev, matching physics_std().  Guard against the small
+    // negative variances float cancellation can produce.
+    float stddev() const {
+        if (_count <= 0) return 0.0f;
+        float m   = _sum / _count;
+        float var = _sumSq / _count - m * m;
+        return (var > 0.0f) ? sqrtf(var) : 0.0f;
+    }
+
+private:
+    float _ring[MAX_WINDOW];
+    int   _window;
+    int   _head;
+    int   _count;
+    float _sum;
+    float _sumSq;
+};
+
+// Min and max over the last `window` values, via monotonic deques.
+// Amortized O(1) per push; never scans the window.
+class RollingMinMax {
+public:
+    static const int MAX_WINDOW = 16;
+
+    explicit RollingMinMax(int window = 10) { reset(window); }
+
+    void reset(int window) {
+        _window = (window > MAX_WINDOW) ? MAX_WINDOW : window;
+        _seq = 0;
+        _minHead = _minTail = 0;
+        _maxHead = _maxTail = 0;
+    }
+
+    void push(float v) {
+        uint32_t expire = (_seq >= (uint32_t)_window)
+                          ? _seq - _window + 1 : 0;
+
+        // Drop expired front entries
+        while (_minHead != _minTail && _minSeq[_minHead] < expire)
+            _minHead = next(_minHead);
+        while (_maxHead != _maxTail && _maxSeq[_maxHead] < expire)
+            _maxHead = next(_maxHead);
+
+        // Maintain monotonicity from the back
+        while (_minHead != _minTail && _minVal[prev(_minTail)] >= v)
+            _minTail = prev(_minTail);
+        _minVal[_minTail] = v;
+        _minSeq[_minTail] = _seq;
+        _minTail = next(_minTail);
+
+        while (_maxHead != _maxTail && _maxVal[prev(_maxTail)] <= v)
+            _maxTail = prev(_maxTail);
+        _maxVal[_maxTail] = v;
+        _maxSeq[_maxTail] = _seq;
+        _maxTail = next(_maxTail);
+
+        _seq++;
+    }
+
+    int   count()  const { return (_seq < (uint32_t)_window) ? (int)_seq : _window; }
+    float minVal() const { return (_minHead != _minTail) ? _minVal[_minHead] : 0.0f; }
+    float maxVal() const { return (_maxHead != _maxTail) ? _maxVal[_maxHead] : 0.0f; }
+    float range()  const { return maxVal() - minVal(); }
+
+private:
+    // Deque capacity must exceed the window by one slot (head==tail means empty)
+    static const int CAP = MAX_WINDOW + 1;
+    int next(int i) const { return (i + 1 == CAP) ? 0 : i + 1; }
+    int prev(int i) const { return (i == 0) ? CAP - 1 : i - 1; }
+
+    float    _minVal[CAP]; uint32_t _minSeq[CAP];
+    float    _maxVal[CAP]; uint32_t _maxSeq[CAP];
+    int      _minHead, _minTail;
+    int      _maxHead, _maxTail;
+    int      _window;
+    uint32_t _seq;
+};
+
+// P² (Jain & Chlamtac) online quantile estimator.  Tracks a single quantile
+// over the full stream with five markers — no window storage, no sorting.
+// Replaces the qsort over a 30-day theta window in updateRefillThreshold.
+class P2Quantile {
+public:
+    explicit P2Quantile(float p = 0.05f) { reset(p); }
+
+    void reset(float p) {
+        _p = p;
+        _count = 0;
+    }
+
+    void add(float x) {
+        if (_count < 5) {
+            // Insertion sort into initial marker heights
+            int i = _count++;
+            while (i > 0 && _q[i - 1] > x) { _q[i] = _q[i - 1]; i--; }
+            _q[i] = x;
+            if (_count == 5) {
+                for (int j = 0; j < 5; j++) _n[j] = j + 1;
+                _np[0] = 1.0f;
+                _np[1] = 1.0f + 2.0f * _p;
+                _np[2] = 1.0f + 4.0f * _p;
+                _np[3] = 3.0f + 2.0f * _p;
+                _np[4] = 5.0f;
+                _dn[0] = 0.0f;
+                _dn[1] = _p / 2.0f;
+                _dn[2] = _p;
+                _dn[3] = (1.0f + _p) / 2.0f;
+                _dn[4] = 1.0f;
+            }
+            return;
+        }
+
+        // Locate cell and update extreme markers
+        int k;
+        if      (x < _q[0]) { _q[0] = x; k = 0; }
+        else if (x < _q[1])   k = 0;
+        else if (x < _q[2])   k = 1;
+        else if (x < _q[3])   k = 2;
+        else if (x < _q[4])   k = 3;
+        else                { _q[4] = x; k = 3; }
+
+        for (int i = k + 1; i < 5; i++) _n[i]++;
+        for (int i = 0; i < 5; i++)     _np[i] += _dn[i];
+        _count++;
+
+        // Adjust interior markers toward their ideal positions
+        for (int i = 1; i <= 3; i++) {
+            float d = _np[i] - _n[i];
+            if ((d >= 1.0f && _n[i + 1] - _n[i] > 1) ||
+                (d <= -1.0f && _n[i - 1] - _n[i] < -1)) {
+                int s = (d >= 0.0f) ? 1 : -1;
+                float qp = parabolic(i, s);
+                if (_q[i - 1] < qp && qp < _q[i + 1])
+                    _q[i] = qp;
+                else
+                    _q[i] = linear(i, s);
+                _n[i] += s;
+            }
+        }
+    }
+
+    long count() const { return _count; }
+
+    // Current estimate; falls back to the middle of the sorted seed values
+    // until five observations have arrived.
+    float value() const {
+        if (_count == 0) return 0.0f;
+        if (_count < 5) {
+            int idx = (int)(_p * (_count - 1) + 0.5f);
+            return _q[idx];
+        }
+        return _q[2];
+    }
+
+private:
+    float parabolic(int i, int s) const {
+        float d = (float)s;
+        return _q[i] + d / (_n[i + 1] - _n[i - 1]) *
+               ((_n[i] - _n[i - 1] + d) * (_q[i + 1] - _q[i]) / (_n[i + 1] - _n[i]) +
+                (_n[i + 1] - _n[i] - d) * (_q[i] - _q[i - 1]) / (_n[i] - _n[i - 1]));
+    }
+
+    float linear(int i, int s) const {
+        return _q[i] + s * (_q[i + s] - _q[i]) / (_n[i + s] - _n[i]);
+    }
+
+    float _p;
+    float _q[5];    // marker heights
+    int   _n[5];    // marker positions
+    float _np[5];   // desired positions
+    float _dn[5];   // desired position increments
+    long  _count = 0;
+};
+
+// Bundle of streaming statistics maintained alongside the history ring.
+// Updated once per pushed point, consumed by QC and auto-calibration.
+struct HistoryStats {
+    RollingWindowStats spikeWindow{5};    // z-score spike check
+    RollingMinMax      stuckWindow{10};   // stuck-sensor range check
+    P2Quantile         thetaDry{0.05f};   // theta_dry percentile estimate
+
+    void reset(float dryPercentile) {
+        spikeWindow.reset(5);
+        stuckWindow.reset(10);
+        thetaDry.reset(dryPercentile);
+    }
+
+    void addTheta(float theta) {
+        spikeWindow.push(theta);
+        stuckWindow.push(theta);
+        thetaDry.add(theta);
+    }
+};
+
+#endif // ROLLING_STATS_H
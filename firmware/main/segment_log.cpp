@@ -0,0 +1,624 @@
+#include "segment_log.h"
+#include "db_manager.h"
+
+// Per-row payload bytes for a version-1 (raw columnar) block:
+// i32 tDelta + 2×i16 adc + 12×f32 + u32 seq + i8 battery + u8 qc
+// + 16+16+8 text bytes.
+static const int SEG_V1_ROW_BYTES = 4 + 2 + 2 + 12 * 4 + 4 + 1 + 1 + 40;
+
+// Worst-case payload bytes per row for a version-2 (compressed) block:
+// every varint at its 5-byte maximum plus every text field changed.  Real
+// rows land around 8-15 bytes; this bound only sizes the buffers.
+static const int SEG_V2_MAX_ROW_BYTES = 160;
+
+// Block staging buffer — written only from the DB writer task (or the
+// synchronous fallback before it starts), same single-writer assumption as
+// the double buffer it drains.
+static uint8_t s_blockBuf[sizeof(SegBlockHeader) +
+                          SegmentLog::BLOCK_MAX_ROWS * SEG_V2_MAX_ROW_BYTES];
+
+// Serializes readers around the shared decode scratch in readBlockAt —
+// unlike the staging buffer above, reads come from more than one task.
+// Created in SegmentLog::begin(), before any reader can exist.
+static SemaphoreHandle_t s_decodeMutex = nullptr;
+
+// --- columnar pack/unpack helpers -------------------------------------------
+
+static inline void packBytes(uint8_t*& p, const void* src, size_t n) {
+    memcpy(p, src, n);
+    p += n;
+}
+
+static inline void unpackBytes(const uint8_t*& p, void* dst, size_t n) {
+    memcpy(dst, p, n);
+    p += n;
+}
+
+// --- compressed (v2) primitives ----------------------------------------------
+// Byte-aligned LEB128 varints instead of Gorilla's bit packing: within a
+// couple of bytes of the bit-packed size on this data, and the decoder
+// stays a dozen lines.
+
+static inline uint32_t zigzag32(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t unzigzag32(uint32_t u) {
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+}
+
+static inline void putVarint(uint8_t*& p, uint32_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+}
+
+// Bounded: never reads at or past `end`.  A varint truncated by a corrupt
+// block leaves p poisoned one past `end`, so callers can bail on p > end
+// without every loop re-deriving the arithmetic.
+static inline uint32_t getVarint(const uint8_t*& p, const uint8_t* end) {
+    uint32_t v = 0;
+    int shift = 0;
+    while (p < end && (*p & 0x80)) {
+        v |= (uint32_t)(*p++ & 0x7f) << shift;
+        shift += 7;
+    }
+    if (p >= end) {
+        p = end + 1;
+        return 0;
+    }
+    v |= (uint32_t)(*p++) << shift;
+    return v;
+}
+
+// Integer column: zigzag varint of the delta from the previous row.  A
+// flat column (battery between reports, seq on the hub) is one byte/row.
+static inline void packDeltaInt(uint8_t*& p, int32_t v, int32_t& prev) {
+    putVarint(p, zigzag32(v - prev));
+    prev = v;
+}
+
+static inline int32_t unpackDeltaInt(const uint8_t*& p, const uint8_t* end,
+                                     int32_t& prev) {
+    prev += unzigzag32(getVarint(p, end));
+    return prev;
+}
+
+// Float column: varint of the IEEE bits XORed with the previous row's.
+// Unchanged values (theta_fc, confidence, ... between recalibrations)
+// cost one zero byte; slow-moving values share exponent and top mantissa
+// bits so the XOR is small.
+static inline void packXorFloat(uint8_t*& p, float v, uint32_t& prev) {
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    putVarint(p, bits ^ prev);
+    prev = bits;
+}
+
+static inline float unpackXorFloat(const uint8_t*& p, const uint8_t* end,
+                                   uint32_t& prev) {
+    prev ^= getVarint(p, end);
+    float v;
+    memcpy(&v, &prev, 4);
+    return v;
+}
+
+// Text column: 0 = same as the previous row, else length+1 followed by
+// the bytes.  Regime/status/urgency change on state transitions only.
+static inline void packText(uint8_t*& p, const char* s, const char*& prev) {
+    if (strcmp(s, prev) == 0) {
+        *p++ = 0;
+    } else {
+        size_t len = strlen(s);
+        putVarint(p, (uint32_t)len + 1);
+        packBytes(p, s, len);
+    }
+    prev = s;
+}
+
+// =============================================================================
+// WRITER
+// =============================================================================
+
+void SegmentLog::pathFor(uint32_t id, char* out, size_t n) const {
+    // %.20s bounds the directory so the worst case (20 + "/seg_" +
+    // 10-digit id + ".bin" + NUL = 40) provably fits the 48-byte path
+    // buffers callers pass in.
+    snprintf(out, n, "%.20s/seg_%06lu.bin", _dir, (unsigned long)id);
+}
+
+bool SegmentLog::begin(const char* dir, uint32_t activeId, bool resume) {
+    // Created once, before the physics task or web server ever open a
+    // Reader — guards the shared decode scratch in readBlockAt.
+    if (!s_decodeMutex)
+        s_decodeMutex = xSemaphoreCreateMutex();
+    snprintf(_dir, sizeof(_dir), "%s", dir);
+    if (!SD.exists(_dir) && !SD.mkdir(_dir)) {
+        Serial.printf("[SEG] Cannot create %s\n", _dir);
+        return false;
+    }
+
+    _segId = activeId;
+    pathFor(_segId, _activePath, sizeof(_activePath));
+
+    if (resume && SD.exists(_activePath)) {
+        _active = SD.open(_activePath, FILE_APPEND);
+        if (_active) {
+            _bytesWritten = _active.size();
+            Serial.printf("[SEG] Resumed %s (%lu bytes)\n", _activePath,
+                          (unsigned long)_bytesWritten);
+            return true;
+        }
+    }
+
+    _active = SD.open(_activePath, FILE_WRITE);
+    if (!_active) {
+        Serial.printf("[SEG] Cannot open %s\n", _activePath);
+        return false;
+    }
+    SegFileHeader fh = {SEG_FILE_MAGIC, 1, 0};
+    _active.write((const uint8_t*)&fh, sizeof(fh));
+    _bytesWritten = sizeof(fh);
+    Serial.printf("[SEG] Created %s\n", _activePath);
+    return true;
+}
+
+void SegmentLog::rotate(uint32_t newId) {
+    if (_active) {
+        _active.flush();
+        _active.close();
+    }
+    _segId = newId;
+    pathFor(_segId, _activePath, sizeof(_activePath));
+    _active = SD.open(_activePath, FILE_WRITE);
+    _bytesWritten = 0;
+    if (_active) {
+        SegFileHeader fh = {SEG_FILE_MAGIC, 1, 0};
+        _active.write((const uint8_t*)&fh, sizeof(fh));
+        _bytesWritten = sizeof(fh);
+        Serial.printf("[SEG] Rotated to %s\n", _activePath);
+    }
+}
+
+bool SegmentLog::appendBlock(const SampleData* rows, int count) {
+    if (!_active || count < 1 || count > BLOCK_MAX_ROWS)
+        return false;
+
+    SegBlockHeader hdr = {};
+    hdr.magic = SEG_BLOCK_MAGIC;
+    hdr.version = 2;
+    hdr.count = (uint8_t)count;
+    hdr.t0 = (int64_t)rows[0].timestamp;
+    hdr.tSpan = (int32_t)(rows[count - 1].timestamp - rows[0].timestamp);
+    snprintf(hdr.device_id, sizeof(hdr.device_id), "%s", rows[0].device_id);
+
+    uint8_t* p = s_blockBuf + sizeof(hdr);
+
+    // Timestamps: delta-of-delta from t0.  A steady sampling cadence makes
+    // every varint after the first a zero byte.
+    {
+        int32_t prevDelta = 0;
+        for (int i = 1; i < count; i++) {
+            int32_t delta =
+                (int32_t)(rows[i].timestamp - rows[i - 1].timestamp);
+            putVarint(p, zigzag32(delta - prevDelta));
+            prevDelta = delta;
+        }
+    }
+
+    // Integer columns: delta varints
+    int32_t prevI;
+    prevI = 0;
+    for (int i = 0; i < count; i++) packDeltaInt(p, rows[i].raw_adc, prevI);
+    prevI = 0;
+    for (int i = 0; i < count; i++) packDeltaInt(p, rows[i].raw_adc_2, prevI);
+
+    // Float columns: XOR varints
+    uint32_t prevF;
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].temp_c, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].humidity, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].air_temp_c, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].theta, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].theta_2, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].theta_fc, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        packXorFloat(p, rows[i].theta_refill, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].psi_kpa, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].aw_mm, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        packXorFloat(p, rows[i].fraction_depleted, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        packXorFloat(p, rows[i].drying_rate, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++) packXorFloat(p, rows[i].confidence, prevF);
+
+    prevI = 0;
+    for (int i = 0; i < count; i++) packDeltaInt(p, rows[i].seq, prevI);
+    prevI = 0;
+    for (int i = 0; i < count; i++)
+        packDeltaInt(p, rows[i].battery_pct, prevI);
+
+    // qc_valid: one bitmask
+    {
+        uint8_t mask[(SegmentLog::BLOCK_MAX_ROWS + 7) / 8] = {};
+        for (int i = 0; i < count; i++)
+            if (rows[i].qc_valid)
+                mask[i / 8] |= (uint8_t)(1 << (i % 8));
+        packBytes(p, mask, (count + 7) / 8);
+    }
+
+    // Text columns: change-flagged
+    const char* prevT;
+    prevT = "";
+    for (int i = 0; i < count; i++) packText(p, rows[i].regime, prevT);
+    prevT = "";
+    for (int i = 0; i < count; i++) packText(p, rows[i].status, prevT);
+    prevT = "";
+    for (int i = 0; i < count; i++) packText(p, rows[i].urgency, prevT);
+
+    hdr.payloadBytes = (uint32_t)(p - s_blockBuf - sizeof(hdr));
+    memcpy(s_blockBuf, &hdr, sizeof(hdr));
+
+    size_t total = (size_t)(p - s_blockBuf);
+    if (_active.write(s_blockBuf, total) != total) {
+        Serial.println("[SEG] Append failed");
+        return false;
+    }
+    _bytesWritten += total;
+    return true;
+}
+
+void SegmentLog::flush() {
+    if (_active)
+        _active.flush();
+}
+
+// =============================================================================
+// READER
+// =============================================================================
+
+bool SegmentLog::Reader::open(const char* path) {
+    close();
+    _f = SD.open(path, FILE_READ);
+    if (!_f)
+        return false;
+    SegFileHeader fh;
+    if (_f.read((uint8_t*)&fh, sizeof(fh)) != sizeof(fh) ||
+        fh.magic != SEG_FILE_MAGIC) {
+        close();
+        return false;
+    }
+    _opened = true;
+    _nextOff = sizeof(SegFileHeader);
+    return true;
+}
+
+void SegmentLog::Reader::close() {
+    if (_opened || _f)
+        _f.close();
+    _opened = false;
+}
+
+static void reverseRange(uint32_t* a, int lo, int hi) {
+    while (lo < hi) {
+        uint32_t t = a[lo];
+        a[lo++] = a[hi];
+        a[hi--] = t;
+    }
+}
+
+int SegmentLog::Reader::scanBlocks(uint32_t* offsets, int maxOffsets,
+                                   const char* deviceId) {
+    if (!_opened)
+        return 0;
+    // Ring over offsets[] so that when more blocks match than fit, the
+    // newest survive (they are what recent-sample queries want).
+    int total = 0;
+    uint32_t off = sizeof(SegFileHeader);
+    uint32_t size = _f.size();
+    SegBlockHeader hdr;
+    while (off + sizeof(hdr) <= size) {
+        _f.seek(off);
+        if (_f.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr))
+            break;
+        if (hdr.magic != SEG_BLOCK_MAGIC || hdr.count == 0 ||
+            hdr.count > BLOCK_MAX_ROWS)
+            break;   // torn tail from a power cut — stop at last good block
+        if (deviceId[0] == '\0' || strcmp(hdr.device_id, deviceId) == 0) {
+            offsets[total % maxOffsets] = off;
+            total++;
+        }
+        off += sizeof(hdr) + hdr.payloadBytes;
+    }
+    if (total <= maxOffsets)
+        return total;
+    // Ring wrapped — rotate so the surviving offsets are ascending again
+    // (three-reversal rotate, no scratch buffer).
+    int head = total % maxOffsets;   // index of the oldest survivor
+    reverseRange(offsets, 0, head - 1);
+    reverseRange(offsets, head, maxOffsets - 1);
+    reverseRange(offsets, 0, maxOffsets - 1);
+    return maxOffsets;
+}
+
+int SegmentLog::Reader::nextBlock(SampleData* out) {
+    if (!_opened)
+        return 0;
+    _f.seek(_nextOff);
+    SegBlockHeader hdr;
+    if (_f.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != SEG_BLOCK_MAGIC)
+        return 0;
+    uint32_t at = _nextOff;
+    _nextOff += sizeof(hdr) + hdr.payloadBytes;
+    return readBlockAt(at, out);
+}
+
+// Decodes a version-1 (raw columnar) block payload into out[].
+static int decodeV1(const SegBlockHeader& hdr, const uint8_t* payload,
+                    SampleData* out) {
+    int count = hdr.count;
+    // v1 is fixed-width, so one upfront check bounds every unpack below.
+    if ((uint32_t)count * SEG_V1_ROW_BYTES > hdr.payloadBytes)
+        return 0;
+    const uint8_t* p = payload;
+    for (int i = 0; i < count; i++) {
+        int32_t d;
+        unpackBytes(p, &d, 4);
+        out[i] = SampleData{};
+        out[i].timestamp = (time_t)(hdr.t0 + d);
+        out[i].setDeviceId(hdr.device_id);
+    }
+    for (int i = 0; i < count; i++) {
+        int16_t v;
+        unpackBytes(p, &v, 2);
+        out[i].raw_adc = v;
+    }
+    for (int i = 0; i < count; i++) {
+        int16_t v;
+        unpackBytes(p, &v, 2);
+        out[i].raw_adc_2 = v;
+    }
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].temp_c, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].humidity, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].air_temp_c, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].theta, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].theta_2, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].theta_fc, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].theta_refill, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].psi_kpa, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].aw_mm, 4);
+    for (int i = 0; i < count; i++)
+        unpackBytes(p, &out[i].fraction_depleted, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].drying_rate, 4);
+    for (int i = 0; i < count; i++) unpackBytes(p, &out[i].confidence, 4);
+    for (int i = 0; i < count; i++) {
+        uint32_t v;
+        unpackBytes(p, &v, 4);
+        out[i].seq = (int)v;
+    }
+    for (int i = 0; i < count; i++) {
+        int8_t v;
+        unpackBytes(p, &v, 1);
+        out[i].battery_pct = v;
+    }
+    for (int i = 0; i < count; i++) {
+        uint8_t v;
+        unpackBytes(p, &v, 1);
+        out[i].qc_valid = v != 0;
+    }
+    for (int i = 0; i < count; i++) {
+        char buf[16];
+        unpackBytes(p, buf, 16);
+        out[i].setRegime(buf);
+    }
+    for (int i = 0; i < count; i++) {
+        char buf[16];
+        unpackBytes(p, buf, 16);
+        out[i].setStatus(buf);
+    }
+    for (int i = 0; i < count; i++) {
+        char buf[8];
+        unpackBytes(p, buf, 8);
+        out[i].setUrgency(buf);
+    }
+    return count;
+}
+
+// Decodes a version-2 (compressed columnar) block payload into out[].
+// Column order mirrors the encoder in appendBlock exactly.
+static int decodeV2(const SegBlockHeader& hdr, const uint8_t* payload,
+                    SampleData* out) {
+    int count = hdr.count;
+    const uint8_t* p = payload;
+    // Every varint below is bounded by `end`; a truncated or corrupt block
+    // poisons p past it (see getVarint) and the per-column checks bail
+    // before the stale prev-chain garbage reaches out[].
+    const uint8_t* end = payload + hdr.payloadBytes;
+
+    out[0] = SampleData{};
+    out[0].timestamp = (time_t)hdr.t0;
+    {
+        int32_t prevDelta = 0;
+        for (int i = 1; i < count; i++) {
+            prevDelta += unzigzag32(getVarint(p, end));
+            out[i] = SampleData{};
+            out[i].timestamp = out[i - 1].timestamp + prevDelta;
+        }
+    }
+    if (p > end)
+        return 0;
+    for (int i = 0; i < count; i++)
+        out[i].setDeviceId(hdr.device_id);
+
+    int32_t prevI;
+    prevI = 0;
+    for (int i = 0; i < count; i++)
+        out[i].raw_adc = unpackDeltaInt(p, end, prevI);
+    prevI = 0;
+    for (int i = 0; i < count; i++)
+        out[i].raw_adc_2 = unpackDeltaInt(p, end, prevI);
+    if (p > end)
+        return 0;
+
+    uint32_t prevF;
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].temp_c = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].humidity = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].air_temp_c = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].theta = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].theta_2 = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].theta_fc = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].theta_refill = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].psi_kpa = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].aw_mm = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].fraction_depleted = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].drying_rate = unpackXorFloat(p, end, prevF);
+    prevF = 0;
+    for (int i = 0; i < count; i++)
+        out[i].confidence = unpackXorFloat(p, end, prevF);
+
+    prevI = 0;
+    for (int i = 0; i < count; i++)
+        out[i].seq = unpackDeltaInt(p, end, prevI);
+    prevI = 0;
+    for (int i = 0; i < count; i++)
+        out[i].battery_pct = unpackDeltaInt(p, end, prevI);
+    if (p > end)
+        return 0;
+
+    if (p + (count + 7) / 8 > end)
+        return 0;
+    for (int i = 0; i < count; i++)
+        out[i].qc_valid = (p[i / 8] >> (i % 8)) & 1;
+    p += (count + 7) / 8;
+
+    // Text columns: 0 = carry the previous row's value forward
+    char prevT[16];
+    prevT[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        uint32_t flag = getVarint(p, end);
+        if (flag > 0) {
+            size_t len = flag - 1;
+            if (len >= sizeof(prevT) || p + len > end)
+                return 0;
+            memcpy(prevT, p, len);
+            prevT[len] = '\0';
+            p += len;
+        }
+        out[i].setRegime(prevT);
+    }
+    prevT[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        uint32_t flag = getVarint(p, end);
+        if (flag > 0) {
+            size_t len = flag - 1;
+            if (len >= sizeof(prevT) || p + len > end)
+                return 0;
+            memcpy(prevT, p, len);
+            prevT[len] = '\0';
+            p += len;
+        }
+        out[i].setStatus(prevT);
+    }
+    prevT[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        uint32_t flag = getVarint(p, end);
+        if (flag > 0) {
+            size_t len = flag - 1;
+            if (len >= sizeof(prevT) || p + len > end)
+                return 0;
+            memcpy(prevT, p, len);
+            prevT[len] = '\0';
+            p += len;
+        }
+        out[i].setUrgency(prevT);
+    }
+
+    // A decode overrunning the payload means a corrupt block
+    if (p > end)
+        return 0;
+    return count;
+}
+
+bool SegmentLog::Reader::readHeaderAt(uint32_t offset, SegBlockHeader& out) {
+    if (!_opened)
+        return false;
+    _f.seek(offset);
+    return _f.read((uint8_t*)&out, sizeof(out)) == sizeof(out) &&
+           out.magic == SEG_BLOCK_MAGIC;
+}
+
+int SegmentLog::Reader::readBlockAt(uint32_t offset, SampleData* out) {
+    if (!_opened)
+        return 0;
+    _f.seek(offset);
+    SegBlockHeader hdr;
+    if (_f.read((uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr) ||
+        hdr.magic != SEG_BLOCK_MAGIC || hdr.count == 0 ||
+        hdr.count > BLOCK_MAX_ROWS)
+        return 0;
+    if (hdr.payloadBytes > sizeof(s_blockBuf) - sizeof(SegBlockHeader))
+        return 0;
+
+    // Payload scratch sized for the worst case of either version.  Reads
+    // only touch sealed bytes — the writer never rewrites committed
+    // offsets — but readers DO run concurrently (the web task's series
+    // cursor and range fallback vs. the physics task's rehydration), so
+    // the shared buffer is held under s_decodeMutex for the read+decode.
+    // Shared-plus-mutex rather than per-Reader: cursors embedding a
+    // Reader live on task stacks, and 2.5 KB per instance doesn't.
+    static uint8_t payload[SegmentLog::BLOCK_MAX_ROWS * SEG_V2_MAX_ROW_BYTES];
+    if (s_decodeMutex)
+        xSemaphoreTake(s_decodeMutex, portMAX_DELAY);
+    int n = 0;
+    if (_f.read(payload, hdr.payloadBytes) == hdr.payloadBytes) {
+        switch (hdr.version) {
+        case 1:
+            n = decodeV1(hdr, payload, out);
+            break;
+        case 2:
+            n = decodeV2(hdr, payload, out);
+            break;
+        default:
+            n = 0;   // unknown encoding — skip rather than misparse
+        }
+    }
+    if (s_decodeMutex)
+        xSemaphoreGive(s_decodeMutex);
+    return n;
+}
@@ -0,0 +1,119 @@
+#ifndef SEGMENT_LOG_H
+#define SEGMENT_LOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SD.h>
+
+struct SampleData;
+
+// =============================================================================
+// APPEND-ONLY COLUMNAR SEGMENT LOG
+// =============================================================================
+// The hot write path for raw sample capture.  Even batched, per-row
+// bind/step through SQLite costs ~2 ms/row on SD; appending a fixed-width
+// columnar block sequentially is the write pattern SD cards are actually
+// fast at, and it wears the flash far less.  SQLite keeps the jobs it is
+// good at: the rollup aggregates and a small `segments` index table
+// (segment id, file, time range, rows) that DBManager maintains so range
+// queries know which files to stream.
+//
+// On-disk layout: each segment file starts with a SegFileHeader and then
+// holds a sequence of blocks.  A block is one device's slice of one flush:
+// a SegBlockHeader followed by columnar arrays (all rows' timestamps as
+// deltas from t0, then all raw_adc values, then all theta values, ...).
+// Readers dispatch on the block version byte:
+//   version 1 — raw columnar arrays (fixed width, 102 B/row)
+//   version 2 — compressed columnar: delta-of-delta zigzag-varint
+//               timestamps, delta-varint integers, Gorilla-style
+//               XOR-varint floats, change-flagged text columns, and a
+//               qc bitmask.  Most columns barely move between consecutive
+//               samples, so the common row costs a handful of bytes.
+// The writer emits version 2; version 1 decoding is kept for segments
+// written before the codec landed.
+
+static const uint32_t SEG_FILE_MAGIC = 0x47534741;   // "AGSG"
+static const uint16_t SEG_BLOCK_MAGIC = 0xB10C;
+
+struct __attribute__((packed)) SegFileHeader {
+    uint32_t magic;        // SEG_FILE_MAGIC
+    uint16_t version;      // file format, currently 1
+    uint16_t reserved;
+};
+
+struct __attribute__((packed)) SegBlockHeader {
+    uint16_t magic;        // SEG_BLOCK_MAGIC
+    uint8_t  version;      // 1 = raw columnar, 2 = compressed columnar
+    uint8_t  count;        // rows in this block
+    uint32_t payloadBytes; // bytes following this header
+    int64_t  t0;           // timestamp of the first row
+    int32_t  tSpan;        // last - first timestamp (range pruning)
+    char     device_id[18];
+    uint8_t  reserved[2];
+};
+
+class SegmentLog {
+public:
+    // One flush from the writer task is at most the double buffer's worth
+    // of rows; blocks are additionally split per device.
+    static const int BLOCK_MAX_ROWS = 16;
+    // Seal and rotate once a segment outgrows this.  256 KB of compressed
+    // blocks ≈ a week-plus of 30 s samples from one device.
+    static const uint32_t SEGMENT_MAX_BYTES = 256 * 1024;
+
+    // Opens the active segment (resuming an unsealed one from a previous
+    // boot, or creating activeId).  Returns false if the directory cannot
+    // be created.
+    bool begin(const char* dir, uint32_t activeId, bool resume);
+
+    // Appends one single-device block.  Rows must be time-ascending.
+    // Returns false on I/O failure (caller falls back to SQLite inserts).
+    bool appendBlock(const SampleData* rows, int count);
+
+    // True if the active segment has outgrown SEGMENT_MAX_BYTES; the caller
+    // seals it in the index and calls rotate().
+    bool needsRotation() const { return _bytesWritten >= SEGMENT_MAX_BYTES; }
+    void rotate(uint32_t newId);
+
+    uint32_t activeId() const { return _segId; }
+    void pathFor(uint32_t id, char* out, size_t n) const;
+    void flush();
+
+    // Streaming block reader over one segment file.
+    class Reader {
+    public:
+        ~Reader() { close(); }
+        bool open(const char* path);
+        void close();
+        // Walks block headers sequentially (skipping payloads) and records
+        // the offsets whose header matches the filter; deviceId empty = all
+        // devices.  When more than maxOffsets blocks match, the NEWEST
+        // maxOffsets are kept (callers read recent data).  Returned offsets
+        // are always time-ascending.
+        int scanBlocks(uint32_t* offsets, int maxOffsets,
+                       const char* deviceId);
+        // Reads and decodes the block at `offset` into out[] (size
+        // BLOCK_MAX_ROWS).  Returns rows decoded, 0 on error.
+        int readBlockAt(uint32_t offset, SampleData* out);
+        // Header-only read — enough for time-range probes (t0 + tSpan)
+        // without decoding a payload.
+        bool readHeaderAt(uint32_t offset, SegBlockHeader& out);
+        // Sequential decode: reads the block at the current position and
+        // advances past it.  Returns 0 at end of file (or a torn tail).
+        int nextBlock(SampleData* out);
+
+    private:
+        File _f;
+        bool _opened = false;
+        uint32_t _nextOff = 0;
+    };
+
+private:
+    char     _dir[32] = "";
+    File     _active;
+    char     _activePath[48] = "";
+    uint32_t _segId = 0;
+    uint32_t _bytesWritten = 0;
+};
+
+#endif // SEGMENT_LOG_H
@@ -0,0 +1,83 @@
+#ifndef SENSOR_FRAME_H
+#define SENSOR_FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// =============================================================================
+// ESP-NOW SENSOR FRAME — SHARED WIRE FORMAT
+// =============================================================================
+// Single source of truth for the packed binary frames cropbands transmit
+// and the hub ingests.  The cropband sketch includes this same file, so
+// nothing Arduino- or hub-specific lives here — both sides must agree
+// byte-for-byte.
+//
+// Frames are fixed-layout and versioned by their first byte.  The hub
+// validates length + CRC (sensorFrameValidate below) and casts the receive
+// buffer in place — no per-field parsing, no allocation in the callback.
+//
+//   v1: original CropBandPacket — single soil ADC, no sequence counter.
+//   v2: adds a second soil ADC and a monotonic sequence counter, which
+//       gives retransmit dedup a real identity (v1 frames dedup on
+//       timestamp alone, which is blind on RTC-less nodes).
+
+static const uint8_t SENSOR_FRAME_V1 = 1;
+static const uint8_t SENSOR_FRAME_V2 = 2;
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;      // SENSOR_FRAME_V1
+  uint16_t raw_adc;     // soil moisture ADC 0-4095, or 0xFFFF if sensor absent
+  float temp_c;         // DS18B20 temp in Celsius, or -1.0 if unavailable
+  float humidity;       // DHT22 humidity %, or -1.0 if unavailable
+  float air_temp_c;     // DHT22 air temp in Celsius, or -1.0 if unavailable
+  uint8_t battery_pct;  // 0-100, or 255 if unknown
+  uint32_t timestamp;   // Unix timestamp or 0 if no RTC
+  uint8_t crc8;         // CRC8 over all preceding bytes
+} SensorFrameV1;
+
+typedef struct __attribute__((packed)) {
+  uint8_t version;      // SENSOR_FRAME_V2
+  uint8_t reserved;     // future flags — transmit as 0
+  uint16_t raw_adc;     // primary soil ADC, or 0xFFFF if sensor absent
+  uint16_t raw_adc_2;   // secondary soil ADC, or 0xFFFF if sensor absent
+  float temp_c;         // DS18B20 temp in Celsius, or -1.0 if unavailable
+  float humidity;       // DHT22 humidity %, or -1.0 if unavailable
+  float air_temp_c;     // DHT22 air temp in Celsius, or -1.0 if unavailable
+  uint8_t battery_pct;  // 0-100, or 255 if unknown
+  uint32_t seq;         // monotonic per boot — retransmit dedup identity
+  uint32_t timestamp;   // Unix timestamp or 0 if no RTC
+  uint8_t crc8;         // CRC8 over all preceding bytes
+} SensorFrameV2;
+
+// CRC8, polynomial 0x07, init 0xFF — identical on both ends of the link.
+inline uint8_t sensorFrameCrc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++)
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+// Length + CRC gate, dispatched on the version byte.  Returns the frame
+// version on success and 0 for anything malformed; callers then cast the
+// buffer to the matching struct.  Trailing bytes beyond the frame are
+// tolerated (some ESP-NOW stacks pad), never counted into the CRC.
+inline uint8_t sensorFrameValidate(const uint8_t *data, int len) {
+  if (len < 1)
+    return 0;
+  size_t want;
+  switch (data[0]) {
+    case SENSOR_FRAME_V1: want = sizeof(SensorFrameV1); break;
+    case SENSOR_FRAME_V2: want = sizeof(SensorFrameV2); break;
+    default: return 0;
+  }
+  if (len < (int)want)
+    return 0;
+  if (sensorFrameCrc8(data, want - 1) != data[want - 1])
+    return 0;
+  return data[0];
+}
+
+#endif // SENSOR_FRAME_H
@@ -0,0 +1,87 @@
+// Arduino/FreeRTOS shim for host-native DBManager builds.  Wider than the
+// replay harness shim because db_manager.cpp touches String, the FreeRTOS
+// task/semaphore API and the SD filesystem; the benchmark only exercises
+// the synchronous paths, so the task primitives are inert stand-ins.
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+using std::max;
+using std::min;
+
+struct SerialShim {
+    void printf(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+    void println(const char* s = "") { fputs(s, stderr); fputc('\n', stderr); }
+    void print(const char* s) { fputs(s, stderr); }
+};
+extern SerialShim Serial;
+
+// Arduino String over std::string — only the surface the firmware uses.
+class String : public std::string {
+public:
+    String() {}
+    String(const char* s) : std::string(s ? s : "") {}
+    String(const std::string& s) : std::string(s) {}
+    String(int v) : std::string(std::to_string(v)) {}
+    String(long v) : std::string(std::to_string(v)) {}
+    String(unsigned long v) : std::string(std::to_string(v)) {}
+    long toInt() const { return atol(c_str()); }
+    bool isEmpty() const { return empty(); }
+};
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - t0)
+        .count();
+}
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0)
+        .count();
+}
+
+inline void delay(unsigned long) {}
+
+// --- FreeRTOS subset -------------------------------------------------------
+// Inert: the benchmark drives writeSampleBatch and the read paths directly
+// on one thread, so mutexes always succeed and task creation is a no-op.
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef int BaseType_t;
+typedef unsigned int TickType_t;
+typedef unsigned int UBaseType_t;
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (void*)1; }
+inline int xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return 1; }
+inline int xSemaphoreGive(SemaphoreHandle_t) { return 1; }
+inline void vTaskDelay(TickType_t) {}
+inline unsigned int ulTaskNotifyTake(int, TickType_t) { return 0; }
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline BaseType_t xTaskCreate(void (*)(void*), const char*, unsigned int,
+                              void*, UBaseType_t, TaskHandle_t*) {
+    return pdFALSE;  // no background writer on the host
+}
+
+#endif // ARDUINO_H
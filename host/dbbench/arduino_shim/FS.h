@@ -0,0 +1,32 @@
+// stdio-backed File for host-native DBManager builds — functional, not a
+// stub, because the segment log round-trips real bytes through it.
+#ifndef FS_H
+#define FS_H
+
+#include <cstdint>
+#include <cstdio>
+
+class File {
+public:
+    FILE* f = nullptr;
+    explicit operator bool() const { return f != nullptr; }
+    size_t write(const uint8_t* b, size_t n) { return fwrite(b, 1, n, f); }
+    size_t read(uint8_t* b, size_t n) { return fread(b, 1, n, f); }
+    size_t size() {
+        long cur = ftell(f);
+        fseek(f, 0, SEEK_END);
+        long end = ftell(f);
+        fseek(f, cur, SEEK_SET);
+        return (size_t)end;
+    }
+    bool seek(uint32_t o) { return fseek(f, (long)o, SEEK_SET) == 0; }
+    void flush() { if (f) fflush(f); }
+    void close() {
+        if (f) {
+            fclose(f);
+            f = nullptr;
+        }
+    }
+};
+
+#endif // FS_H
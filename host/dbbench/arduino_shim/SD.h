@@ -0,0 +1,49 @@
+// SD card shim that maps the firmware's absolute card paths ("/segments/…")
+// into a sandbox directory on the host filesystem.  The benchmark calls
+// SD.setRoot() with a fresh temp dir before constructing DBManager.
+#ifndef SD_H
+#define SD_H
+
+#include <string>
+#include <sys/stat.h>
+
+#include "FS.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+class SDClass {
+public:
+    void setRoot(const char* root) { _root = root; }
+
+    File open(const char* path, const char* mode = FILE_READ) {
+        const char* m = "rb";
+        if (mode[0] == 'w') m = "wb+";
+        else if (mode[0] == 'a') m = "ab+";
+        File f;
+        f.f = fopen(real(path).c_str(), m);
+        return f;
+    }
+    bool exists(const char* path) {
+        struct stat st;
+        return stat(real(path).c_str(), &st) == 0;
+    }
+    bool mkdir(const char* path) { return ::mkdir(real(path).c_str(), 0755) == 0; }
+    bool remove(const char* path) { return ::remove(real(path).c_str()) == 0; }
+
+    // String-path overloads (the firmware mixes both)
+    File open(const std::string& p, const char* mode = FILE_READ) {
+        return open(p.c_str(), mode);
+    }
+    bool exists(const std::string& p) { return exists(p.c_str()); }
+    bool remove(const std::string& p) { return remove(p.c_str()); }
+
+private:
+    std::string real(const char* path) const { return _root + path; }
+    std::string _root;
+};
+
+extern SDClass SD;
+
+#endif // SD_H
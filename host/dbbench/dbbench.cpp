@@ -0,0 +1,213 @@
+// Host-native microbenchmarks for the DBManager storage paths.
+//
+// Links db_manager.cpp and segment_log.cpp unmodified against stock
+// sqlite3 and the shims in arduino_shim/, then measures:
+//
+//   write_batch    writeSampleBatch throughput across batch sizes
+//   read_recent    getRecentSamples(100) latency distribution
+//   read_range     getSamplesInRange(24 h window) latency distribution
+//   clean_old      cleanOldData stall time
+//   dedup          deduplicateRows stall time
+//
+// Results are emitted as one JSON object per line on stdout so CI can
+// diff them across firmware releases; progress chatter goes to stderr.
+//
+// Usage:
+//   dbbench [--rows 10000,100000[,1000000]]
+//
+// Absolute timings on a laptop are not the point — the SD card is two
+// orders of magnitude slower — but the relative cost of the SQL paths
+// (parse/plan/step, partition fan-out, rollup upserts) tracks well.
+
+#include <Arduino.h>
+#include <SD.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "db_manager.h"
+
+SerialShim Serial;
+SDClass SD;
+
+using clk = std::chrono::steady_clock;
+
+static double ms(clk::time_point a, clk::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+static double pct(std::vector<double>& sorted, double p) {
+    size_t i = (size_t)(p * (sorted.size() - 1));
+    return sorted[i];
+}
+
+// One synthetic sample; i indexes time (15 s cadence ending now) and
+// rotates across four device ids so per-device paths are exercised.
+static SampleData makeSample(long i, long total, time_t now) {
+    SampleData s;
+    s.timestamp = now - (time_t)(total - 1 - i) * 15;
+    s.raw_adc = 1500 + (int)(i % 700);
+    s.raw_adc_2 = 1600 + (int)(i % 650);
+    s.temp_c = 20.0f + (i % 100) * 0.1f;
+    s.humidity = 55.0f;
+    s.air_temp_c = 24.0f;
+    s.theta = 0.20f + (i % 200) * 0.001f;
+    s.theta_2 = 0.21f;
+    s.theta_fc = 0.31f;
+    s.theta_refill = 0.21f;
+    s.psi_kpa = -30.0f;
+    s.aw_mm = 25.0f;
+    s.fraction_depleted = 0.4f;
+    s.drying_rate = 0.002f;
+    s.setRegime("drydown");
+    s.setStatus("ok");
+    s.setUrgency("none");
+    s.confidence = 0.8f;
+    s.qc_valid = true;
+    s.seq = (int)i;
+    char dev[18];
+    snprintf(dev, sizeof(dev), "BENCH_DEV_%ld", i % 4);
+    s.setDeviceId(dev);
+    s.battery_pct = 90;
+    return s;
+}
+
+// Fresh sandbox + DBManager per scenario so runs do not contaminate
+// each other.  Returns the db path (kept alive for DBManager's pointer).
+static std::string benchRoot;
+static std::vector<std::string> dbPaths;
+
+static DBManager* freshDb(const char* tag) {
+    std::string dir = benchRoot + "/" + tag;
+    ::mkdir(dir.c_str(), 0755);
+    SD.setRoot(dir.c_str());
+    dbPaths.push_back(dir + "/agriscan.db");
+    DBManager* db = new DBManager(dbPaths.back().c_str());
+    if (!db->init()) {
+        fprintf(stderr, "dbbench: init failed for %s\n", tag);
+        exit(1);
+    }
+    return db;
+}
+
+static void populate(DBManager* db, long rows, time_t now) {
+    std::vector<SampleData> batch;
+    batch.reserve(512);
+    for (long i = 0; i < rows;) {
+        batch.clear();
+        long n = std::min((long)512, rows - i);
+        for (long j = 0; j < n; j++)
+            batch.push_back(makeSample(i + j, rows, now));
+        db->writeSampleBatch(batch);
+        i += n;
+    }
+}
+
+static void benchWrite(time_t now) {
+    const int batches[] = { 16, 64, 256, 1024 };
+    for (int b : batches) {
+        char tag[32];
+        snprintf(tag, sizeof(tag), "write_%d", b);
+        DBManager* db = freshDb(tag);
+        const long total = 4096;
+        std::vector<SampleData> batch;
+        batch.reserve(b);
+        auto t0 = clk::now();
+        for (long i = 0; i < total;) {
+            batch.clear();
+            long n = std::min((long)b, total - i);
+            for (long j = 0; j < n; j++)
+                batch.push_back(makeSample(i + j, total, now));
+            db->writeSampleBatch(batch);
+            i += n;
+        }
+        double wall = ms(t0, clk::now());
+        printf("{\"bench\":\"write_batch\",\"batch_rows\":%d,"
+               "\"rows\":%ld,\"wall_ms\":%.1f,\"rows_per_s\":%.0f,"
+               "\"ms_per_batch\":%.3f}\n",
+               b, total, wall, total / (wall / 1000.0),
+               wall / ((total + b - 1) / b));
+        delete db;
+    }
+}
+
+static void benchReads(long rows, time_t now) {
+    char tag[32];
+    snprintf(tag, sizeof(tag), "read_%ld", rows);
+    DBManager* db = freshDb(tag);
+    auto p0 = clk::now();
+    populate(db, rows, now);
+    fprintf(stderr, "# populated %ld rows in %.1f ms\n", rows,
+            ms(p0, clk::now()));
+
+    const int iters = 50;
+    std::vector<double> recent, range;
+    for (int i = 0; i < iters; i++) {
+        auto t0 = clk::now();
+        volatile size_t n1 = db->getRecentSamples(100).size();
+        auto t1 = clk::now();
+        volatile size_t n2 =
+            db->getSamplesInRange(now - 86400, now).size();
+        auto t2 = clk::now();
+        (void)n1;
+        (void)n2;
+        recent.push_back(ms(t0, t1));
+        range.push_back(ms(t1, t2));
+    }
+    std::sort(recent.begin(), recent.end());
+    std::sort(range.begin(), range.end());
+    printf("{\"bench\":\"read_recent\",\"rows\":%ld,\"iters\":%d,"
+           "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+           rows, iters, pct(recent, 0.50), pct(recent, 0.99), recent.back());
+    printf("{\"bench\":\"read_range\",\"rows\":%ld,\"iters\":%d,"
+           "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+           rows, iters, pct(range, 0.50), pct(range, 0.99), range.back());
+
+    // Maintenance stalls on the same populated store: keep half the span.
+    int spanDays = (int)((rows * 15L) / 86400L);
+    int keepDays = std::max(1, spanDays / 2);
+    auto c0 = clk::now();
+    db->cleanOldData(keepDays);
+    double cleanMs = ms(c0, clk::now());
+    printf("{\"bench\":\"clean_old\",\"rows\":%ld,\"keep_days\":%d,"
+           "\"wall_ms\":%.1f}\n",
+           rows, keepDays, cleanMs);
+
+    auto d0 = clk::now();
+    int removed = db->deduplicateRows();
+    double dedupMs = ms(d0, clk::now());
+    printf("{\"bench\":\"dedup\",\"rows\":%ld,\"removed\":%d,"
+           "\"wall_ms\":%.1f}\n",
+           rows, removed, dedupMs);
+    delete db;
+}
+
+int main(int argc, char** argv) {
+    std::vector<long> rowCounts = { 10000, 100000 };
+    for (int i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "--rows") == 0) {
+            rowCounts.clear();
+            char* tok = strtok(argv[i + 1], ",");
+            while (tok) {
+                rowCounts.push_back(atol(tok));
+                tok = strtok(nullptr, ",");
+            }
+        }
+    }
+
+    char tmpl[] = "/tmp/dbbench.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    benchRoot = tmpl;
+    time_t now = time(nullptr);
+    fprintf(stderr, "# sandbox %s\n", benchRoot.c_str());
+
+    benchWrite(now);
+    for (long rows : rowCounts)
+        benchReads(rows, now);
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Thin Arduino.h shim for host-native builds of the physics engine.
+// Provides only what physics_engine.h and its includes actually touch:
+// the fixed-width/stdio/ctime headers Arduino pulls in implicitly,
+// min/max, Serial.printf, and millis()/micros() backed by the steady
+// clock.  Deliberately excludes FS/SD/WiFi — code that needs hardware
+// does not belong in the replay build.
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+using std::max;
+using std::min;
+
+struct SerialShim {
+    void printf(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        vfprintf(stdout, fmt, ap);
+        va_end(ap);
+    }
+    void println(const char* s = "") { puts(s); }
+    void print(const char* s) { fputs(s, stdout); }
+};
+extern SerialShim Serial;
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - t0)
+        .count();
+}
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point t0 = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - t0)
+        .count();
+}
+
+inline void delay(unsigned long) {}
+
+#endif // ARDUINO_H
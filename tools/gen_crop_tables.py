@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""Generates firmware/main/crop_tables.h from config/crop_thresholds.json.
+
+The firmware used to parse the full thresholds JSON off SD at every boot
+(1,600 lines, a 12 KB ArduinoJson DOM held during setup).  Baking the
+tables into a constexpr header removes the parse and the heap spike;
+the JSON on SD remains as an optional override for field-tuned values.
+
+Run from the repo root whenever crop_thresholds.json changes:
+
+    python3 tools/gen_crop_tables.py
+
+and commit the regenerated header alongside the JSON.
+"""
+
+import json
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC = os.path.join(ROOT, "config", "crop_thresholds.json")
+DST = os.path.join(ROOT, "firmware", "main", "crop_tables.h")
+
+
+def f(x):
+    """Float literal with an explicit f suffix."""
+    s = "%g" % float(x)
+    if "." not in s and "e" not in s:
+        s += ".0"
+    return s + "f"
+
+
+def main():
+    with open(SRC) as fp:
+        doc = json.load(fp)
+
+    crops = doc["crops"]
+    soils = doc["soils"]
+
+    stages = []       # flat stage rows, crop-major
+    crop_rows = []    # (key, total_days, stage_first, stage_count)
+    for key in crops:
+        c = crops[key]
+        first = len(stages)
+        for s in c["stages"]:
+            stages.append((s["name"], s["day_start"], s["day_end"],
+                           s["Zr_cm"], s["p"]))
+        crop_rows.append((key, c["total_days"], first, len(stages) - first))
+
+    soil_rows = [(key, soils[key]["theta_fc"], soils[key]["theta_wp"])
+                 for key in soils]
+
+    out = []
+    out.append("#ifndef CROP_TABLES_H")
+    out.append("#define CROP_TABLES_H")
+    out.append("")
+    out.append("// Generated by tools/gen_crop_tables.py from "
+               "config/crop_thresholds.json")
+    out.append("// (version %s) — do not edit by hand; rerun the generator."
+               % json.dumps(doc.get("version", "?")))
+    out.append("//")
+    out.append("// Compile-time crop/soil parameter tables.  Stage rows are")
+    out.append("// flattened crop-major so a crop is a [first, first+count)")
+    out.append("// slice of CROP_STAGES.  Keys match the JSON keys exactly;")
+    out.append("// the JSON on SD is now only an override layer.")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("#include <string.h>")
+    out.append("")
+    out.append("struct CropStageRow {")
+    out.append("    const char* name;")
+    out.append("    int16_t     day_start;")
+    out.append("    int16_t     day_end;")
+    out.append("    float       Zr_cm;")
+    out.append("    float       p;")
+    out.append("};")
+    out.append("")
+    out.append("struct CropRow {")
+    out.append("    const char* key;")
+    out.append("    int16_t     total_days;")
+    out.append("    int16_t     stage_first;")
+    out.append("    int16_t     stage_count;")
+    out.append("};")
+    out.append("")
+    out.append("struct SoilRow {")
+    out.append("    const char* key;")
+    out.append("    float       theta_fc;")
+    out.append("    float       theta_wp;")
+    out.append("};")
+    out.append("")
+    out.append("constexpr SoilRow SOIL_TABLE[] = {")
+    for key, fc, wp in soil_rows:
+        out.append('    { "%s", %s, %s },' % (key, f(fc), f(wp)))
+    out.append("};")
+    out.append("constexpr int SOIL_TABLE_LEN = %d;" % len(soil_rows))
+    out.append("")
+    out.append("constexpr CropStageRow CROP_STAGES[] = {")
+    for name, ds, de, zr, p in stages:
+        out.append('    { "%s", %d, %d, %s, %s },' % (name, ds, de,
+                                                      f(zr), f(p)))
+    out.append("};")
+    out.append("")
+    out.append("constexpr CropRow CROP_TABLE[] = {")
+    for key, td, first, count in crop_rows:
+        out.append('    { "%s", %d, %d, %d },' % (key, td, first, count))
+    out.append("};")
+    out.append("constexpr int CROP_TABLE_LEN = %d;" % len(crop_rows))
+    out.append("")
+    out.append("// Linear scans — %d crops / %d soils, called once per boot"
+               % (len(crop_rows), len(soil_rows)))
+    out.append("// (or per crop change), so nothing fancier is warranted.")
+    out.append("// Return -1 when the key is unknown.")
+    out.append("inline int findCropIndex(const char* key) {")
+    out.append("    for (int i = 0; i < CROP_TABLE_LEN; i++)")
+    out.append("        if (strcmp(CROP_TABLE[i].key, key) == 0) return i;")
+    out.append("    return -1;")
+    out.append("}")
+    out.append("")
+    out.append("inline int findSoilIndex(const char* key) {")
+    out.append("    for (int i = 0; i < SOIL_TABLE_LEN; i++)")
+    out.append("        if (strcmp(SOIL_TABLE[i].key, key) == 0) return i;")
+    out.append("    return -1;")
+    out.append("}")
+    out.append("")
+    out.append("// Stage active at the given days-after-planting; falls back")
+    out.append("// to the crop's last stage past the end of the schedule.")
+    out.append("inline const CropStageRow& cropStageFor(const CropRow& crop,")
+    out.append("                                        int dap) {")
+    out.append("    int last = crop.stage_first + crop.stage_count - 1;")
+    out.append("    for (int i = crop.stage_first; i <= last; i++) {")
+    out.append("        if (dap >= CROP_STAGES[i].day_start &&")
+    out.append("            dap <= CROP_STAGES[i].day_end)")
+    out.append("            return CROP_STAGES[i];")
+    out.append("    }")
+    out.append("    return CROP_STAGES[last];")
+    out.append("}")
+    out.append("")
+    out.append("#endif // CROP_TABLES_H")
+    out.append("")
+
+    with open(DST, "w") as fp:
+        fp.write("\n".join(out))
+    print("wrote %s: %d crops, %d stage rows, %d soils"
+          % (os.path.relpath(DST, ROOT), len(crop_rows), len(stages),
+             len(soil_rows)))
+
+
+if __name__ == "__main__":
+    sys.exit(main())